@@ -12,6 +12,8 @@ For a C++ project simply rename the file to .cpp and run premake
 #include "imnodes.h"
 #include "imgui.h"
 #include "script_graph.h"
+#include "graph_serializer.h"
+#include "timer_wheel.h"
 #include "extras/IconsFontAwesome5.h"
 #include "tinyfiledialogs.h"
 #include "NodeGraphEditor.h"
@@ -27,83 +29,17 @@ std::vector<std::string> NodeRegistryCache;
 
 std::list<std::string> LogLines;
 
-void SaveScript(const ScriptGraph& graph, const std::string& filename)
-{
-	ScriptResource scriptRes;
-	graph.Write(scriptRes);
-
-	FILE* fp = fopen(filename.c_str(), "w+");
-	if (!fp)
-		return;
-
-	uint32_t count = uint32_t(scriptRes.Nodes.size());
-
-	fwrite(&count, 4, 1, fp);
-
-	for (const auto& res : scriptRes.Nodes)
-	{
-		fwrite(&res.ID, 4, 1, fp);
-
-		unsigned char isEntry = res.EntryPoint ? 1 : 0;
-		fwrite(&isEntry, 1, 1, fp);
-
-		fwrite(res.TypeName, NodeResource::MaxNodeName, 1, fp);
-		fwrite(res.Name, NodeResource::MaxNodeName, 1, fp);
-
-		uint32_t size = uint32_t(res.DataSize);
-		fwrite(&size, 4, 1, fp);
-		fwrite(res.Data, res.DataSize, 1, fp);
-	}
-	fclose(fp);
-}
-
-ScriptGraph LoadScript(const std::string& filename)
-{
-	ScriptGraph script;
-	FILE* fp = fopen(filename.c_str(), "r");
-	if (!fp)
-		return script;
-
-	ScriptResource res;
-	uint32_t count = 0;
-	fread(&count, 4, 1, fp);
-
-	for (uint32_t i = 0; i < count; i++)
-	{
-		NodeResource nodeRes;
-
-		fread(&nodeRes.ID, 4, 1, fp);
-		unsigned char b = 0;
-		fread(&b, 1, 1, fp);
-		nodeRes.EntryPoint = b != 0;
-
-		fread(nodeRes.TypeName, NodeResource::MaxNodeName, 1, fp);
-		fread(nodeRes.Name, NodeResource::MaxNodeName, 1, fp);
-
-		uint32_t size = 0;
-		fread(&size, 4, 1, fp);
-		nodeRes.DataSize = size_t(size);
-		nodeRes.Data = malloc(size);
-		if (nodeRes.Data)
-			fread(nodeRes.Data, nodeRes.DataSize, 1, fp);
-		else
-			break;
-
-		res.Nodes.emplace_back(std::move(nodeRes));
-	}
-
-	fclose(fp);
-
-	script.Read(res);
-	return script;
-}
-
 ScriptGraph TheGraph;
 std::string GraphPath;
 bool GraphNew = true;
 
 ScriptInstance Instance(TheGraph);
 
+constexpr std::chrono::microseconds ScriptFrameBudget(2000);
+
+// holds the instance while it sits on a delay node
+TimerWheel ScriptTimers;
+
 void SetupImGui()
 {
 	rlImGuiBeginInitImGui();
@@ -179,6 +115,7 @@ void SetupScripting()
 		});
 
 	AddNodeIcon(Loop::GetTypeName(), ICON_FA_RECYCLE);
+	AddNodeIcon(Delay::GetTypeName(), ICON_FA_HOURGLASS);
 
 	PrintLog::LogFunction = [](const std::string& text)
 	{
@@ -268,6 +205,7 @@ void DoMainMenu()
 				GraphNew = true;
 				TheGraph.EntryNodes.clear();
 				TheGraph.Nodes.clear();
+				TheGraph.NodeTable.clear();
 				GraphPath.clear();
 			}
 			ImGui::Separator();
@@ -287,7 +225,7 @@ void DoMainMenu()
 				if (fileName != nullptr)
 				{
 					GraphPath = fileName;
-					TheGraph = LoadScript(GraphPath);
+					TheGraph = GraphSerializer::LoadScript(GraphPath);
 				}
 			}
 
@@ -314,7 +252,7 @@ void DoMainMenu()
 				}
 
 				if (!GraphPath.empty())
-					SaveScript(TheGraph, GraphPath);
+					GraphSerializer::SaveScript(TheGraph, GraphPath);
 			}
 
 			if (ImGui::MenuItem("Save As"))
@@ -332,7 +270,7 @@ void DoMainMenu()
 				if (fileName != nullptr)
 				{
 					GraphPath = fileName;
-					SaveScript(TheGraph, GraphPath);
+					GraphSerializer::SaveScript(TheGraph, GraphPath);
 				}
 			}
 
@@ -347,7 +285,10 @@ void DoMainMenu()
 			if (ImGui::MenuItem("Run"))
 			{
 				if (!Instance.Running)
+				{
+					TheGraph.Compile();
 					Instance.Start(TheGraph.EntryNodes.begin()->first);
+				}
 			}
 			ImGui::EndMenu();
 		}
@@ -525,9 +466,12 @@ int main ()
 	// game loop
 	while (!WindowShouldClose() && !Quit)
 	{
-		if (Instance.Running)
+		ScriptTimers.Advance(GetFrameTime());
+
+		if (Instance.Running && !Instance.IsWaiting())
 		{
-			switch (Instance.Step())
+			// give the script a slice of each frame instead of a single node
+			switch (Instance.StepFor(ScriptFrameBudget).Status)
 			{
 				case ScriptInstance::Result::Complete:
 					LogLines.push_back("Script Complete");
@@ -536,6 +480,13 @@ int main ()
 				case ScriptInstance::Result::Error:
 					LogLines.push_back("Script Error");
 					break;
+
+				case ScriptInstance::Result::Waiting:
+					ScriptTimers.Park(Instance);
+					break;
+
+				default:
+					break;
 			}
 		}
 
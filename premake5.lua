@@ -74,6 +74,10 @@ workspace (workspaceName)
     filter { "platforms:x64" }
         architecture "x86_64"
 
+    -- the script scheduler runs on std::thread
+    filter { "system:linux" }
+        links { "pthread" }
+
     filter {}
 
     targetdir "_bin/%{cfg.buildcfg}/"
@@ -0,0 +1,84 @@
+/*
+Ahead of time compiler for script graphs.
+
+Reads a saved .script file and writes a C++ source file with one function per entry point.
+Build the output into the game and call the generated register function before loading the
+script, ScriptInstance::Run will then call the generated code instead of interpreting it.
+
+usage: script_aot <input.script> <output.cpp> [register function name]
+*/
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "script_graph.h"
+#include "graph_serializer.h"
+#include "script_program.h"
+#include "transpiler.h"
+
+std::string GetRegisterFunctionName(const std::string& inputPath)
+{
+	size_t start = inputPath.find_last_of("/\\");
+	start = start == std::string::npos ? 0 : start + 1;
+
+	size_t end = inputPath.find_last_of('.');
+	if (end == std::string::npos || end < start)
+		end = inputPath.size();
+
+	std::string name = "Register";
+	bool upper = true;
+	for (size_t i = start; i < end; i++)
+	{
+		char c = inputPath[i];
+		if (!isalnum((unsigned char)c))
+		{
+			upper = true;
+			continue;
+		}
+
+		name += upper ? char(toupper((unsigned char)c)) : c;
+		upper = false;
+	}
+
+	return name + "Script";
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		printf("usage: script_aot <input.script> <output.cpp> [register function name]\n");
+		return 1;
+	}
+
+	std::string inputPath = argv[1];
+	std::string outputPath = argv[2];
+	std::string registerFunction = argc > 3 ? argv[3] : GetRegisterFunctionName(inputPath);
+
+	NodeRegistry::RegisterDefaultNodes();
+
+	ScriptGraph graph = GraphSerializer::LoadScript(inputPath);
+	const auto& program = graph.GetProgram();
+	if (!program || program->EntryPoints.empty())
+	{
+		printf("%s has no entry points\n", inputPath.c_str());
+		return 1;
+	}
+
+	Transpiler transpiler(*program);
+	std::string source = transpiler.GenerateSource(inputPath, registerFunction);
+
+	for (const std::string& skipped : transpiler.Skipped)
+		printf("skipped %s\n", skipped.c_str());
+
+	FILE* fp = fopen(outputPath.c_str(), "w");
+	if (!fp)
+	{
+		printf("unable to write %s\n", outputPath.c_str());
+		return 1;
+	}
+
+	fwrite(source.data(), source.size(), 1, fp);
+	fclose(fp);
+
+	printf("wrote %zu entry points to %s\n", program->EntryPoints.size() - transpiler.Skipped.size(), outputPath.c_str());
+	return 0;
+}
@@ -0,0 +1,30 @@
+
+baseName = path.getbasename(os.getcwd());
+
+project (baseName)
+    kind "ConsoleApp"
+    location "../_build"
+    targetdir "../_bin/%{cfg.buildcfg}"
+
+    filter "action:vs*"
+        debugdir "$(SolutionDir)"
+		
+--	filter {"action:vs*", "configurations:Release"}
+--		kind "WindowedApp"
+--		entrypoint "mainCRTStartup"
+		
+    filter{}
+
+    vpaths 
+    {
+        ["Header Files/*"] = { "include/**.h",  "include/**.hpp", "src/**.h", "src/**.hpp", "**.h", "**.hpp"},
+        ["Source Files/*"] = {"src/**.c", "src/**.cpp","**.c", "**.cpp"},
+    }
+    files {"**.c", "**.cpp", "**.h", "**.hpp"}
+  
+    includedirs { "./"}
+	includedirs {"src"}
+	includedirs {"include"}
+	link_to("script_graph");
+	
+	-- To link to a lib use link_to("LIB_FOLDER_NAME")
\ No newline at end of file
@@ -0,0 +1,491 @@
+#include "transpiler.h"
+
+#include <cstdio>
+
+Transpiler::Transpiler(const ScriptProgram& program)
+	: Program(program)
+{
+}
+
+std::string Transpiler::GenerateSource(const std::string& sourceName, const std::string& registerFunction)
+{
+	std::string functions;
+	std::string registrations;
+	Skipped.clear();
+
+	for (const auto& [name, handle] : Program.EntryPoints)
+	{
+		uint32_t entryPc = Program.GetEntryPoint(handle);
+		if (entryPc == ScriptProgram::InvalidTarget)
+			continue;
+
+		std::string functionName = "Entry_" + Identifier(name) + "_" + std::to_string(handle);
+
+		std::string function;
+		if (!GenerateEntry(entryPc, functionName, function))
+		{
+			Skipped.push_back(name + ": " + Error);
+			continue;
+		}
+
+		functions += function + "\n";
+
+		char hash[32] = { 0 };
+		snprintf(hash, sizeof(hash), "0x%016llxull", (unsigned long long)Program.Hash);
+		registrations += "\tNodeRegistry::RegisterPrecompiledEntry(" + std::string(hash) + ", " + QuoteString(name) + ", " + functionName + ");\n";
+	}
+
+	std::string source;
+	source += "// Generated by script_aot from " + sourceName + ", do not edit.\n";
+	source += "// Call " + registerFunction + "() before loading the script so that Run uses these functions.\n\n";
+	source += "#include \"script_graph.h\"\n\n";
+	source += "#include <limits>\n";
+	source += "#include <string>\n\n";
+	source += functions;
+	source += "void " + registerFunction + "()\n{\n" + registrations + "}\n";
+	return source;
+}
+
+bool Transpiler::GenerateEntry(uint32_t entryPc, const std::string& functionName, std::string& out)
+{
+	Contexts.assign(1, Context());
+	Blocks.clear();
+	Pending.clear();
+	Queued.clear();
+	Referenced.clear();
+	UsedSlots.clear();
+	WrittenSlots.clear();
+	TextSlots.clear();
+	UsesText = false;
+	LoopNodes.clear();
+	Error.clear();
+
+	// the first block is reached by falling into it, not by a jump
+	Target(entryPc, 0);
+	Referenced.clear();
+
+	for (size_t i = 0; i < Pending.size(); i++)
+	{
+		Block block;
+		block.Pc = Pending[i].first;
+		block.Context = Pending[i].second;
+		if (!EmitBlock(block.Pc, block.Context, block.Code))
+			return false;
+
+		Blocks.push_back(block);
+	}
+
+	out = "static void " + functionName + "(ScriptInstance& instance)\n{\n";
+	out += "\t(void)instance;\n\n";
+
+	// loop indexes live for the whole run, the same as the interpreter's per node state
+	for (uint32_t nodeId : LoopNodes)
+		out += "\tint loop" + std::to_string(nodeId) + " = -1;\n";
+
+	for (uint32_t slot : UsedSlots)
+		out += SlotDeclaration(slot);
+
+	// text made while running lives here for the run, literals are interned once by the static slots
+	for (uint32_t slot : TextSlots)
+		out += "\tstd::string t" + std::to_string(slot) + ";\n";
+
+	if (UsesText)
+		out += "\tstd::string name;\n\tstd::string text;\n";
+
+	for (const Block& block : Blocks)
+	{
+		out += "\n";
+		if (Referenced.count({ block.Pc, block.Context }))
+			out += Label(block.Pc, block.Context) + ":\n";
+
+		out += block.Code;
+	}
+
+	out += "}\n";
+	return true;
+}
+
+bool Transpiler::EmitBlock(uint32_t pc, uint32_t context, std::string& out)
+{
+	const Instruction ins = ScriptProgram::Unfuse(Program.Code[pc]);
+
+	// loops evaluate their condition once the index has moved
+	if (ins.Op != OpCode::Loop && !EmitValues(ins.ValueBegin, ins.ValueEnd, out))
+		return false;
+
+	bool hasArg0 = ins.Args[0] != ScriptProgram::InvalidSlot;
+	bool hasArg1 = ins.Args[1] != ScriptProgram::InvalidSlot;
+
+	switch (ins.Op)
+	{
+		case OpCode::Entry:
+		case OpCode::Jump:
+			out += "\t" + Target(ins.Next[0], context) + "\n";
+			return true;
+
+		case OpCode::Condition:
+			if (hasArg0)
+			{
+				out += "\tif (" + Read(ins.Args[0], ValueTypes::Boolean) + ")\n";
+				out += "\t\t" + Target(ins.Next[0], context) + "\n";
+				out += "\t" + Target(ins.Next[1], context) + "\n";
+			}
+			else
+			{
+				out += "\t" + Target(ScriptProgram::InvalidTarget, context) + "\n";
+			}
+			return true;
+
+		case OpCode::Loop:
+		{
+			uint32_t body = EnterLoop(pc, context);
+			if (body == uint32_t(-1))
+				return false;
+
+			std::string index = "loop" + std::to_string(ins.NodeId);
+			LoopNodes.insert(ins.NodeId);
+
+			out += "\t" + index + " = " + index + " < 0 ? 0 : " + index + " + 1;\n";
+			if (ins.Operand > 0)
+			{
+				out += "\tif (" + index + " >= " + std::to_string(ins.Operand) + ")\n";
+				out += "\t\t" + Target(ins.Next[0], context) + "\n";
+			}
+
+			if (!EmitValues(ins.ValueBegin, ins.ValueEnd, out))
+				return false;
+
+			if (hasArg0)
+			{
+				out += "\tif (!" + Read(ins.Args[0], ValueTypes::Boolean) + ")\n";
+				out += "\t\t" + Target(ins.Next[0], context) + "\n";
+			}
+
+			out += "\t" + Target(ins.Next[1], body) + "\n";
+			return true;
+		}
+
+		case OpCode::PrintLog:
+			if (hasArg0)
+				out += "\tPrintLog::LogFunction(" + Text(ins.Args[0], "text") + ");\n";
+			break;
+
+		case OpCode::SaveBool:
+			if (hasArg0 && hasArg1)
+				out += "\tinstance.SetBool(" + Text(ins.Args[0], "name") + ", " + Read(ins.Args[1], ValueTypes::Boolean) + ");\n";
+			break;
+
+		case OpCode::SaveNumber:
+			if (hasArg0 && hasArg1)
+				out += "\tinstance.SetNumber(" + Text(ins.Args[0], "name") + ", " + Read(ins.Args[1], ValueTypes::Number) + ");\n";
+			break;
+
+		case OpCode::SaveString:
+			if (hasArg0 && hasArg1)
+				out += "\tinstance.SetString(" + Text(ins.Args[0], "name") + ", " + Text(ins.Args[1], "text") + ");\n";
+			break;
+
+		case OpCode::SaveBoolGlobal:
+			if (hasArg1)
+				out += "\tinstance.BoolGlobalSlots[" + std::to_string(ins.Operand) + "] = " + Read(ins.Args[1], ValueTypes::Boolean) + ";\n";
+			break;
+
+		case OpCode::SaveNumberGlobal:
+			if (hasArg1)
+				out += "\tinstance.NumGlobalSlots[" + std::to_string(ins.Operand) + "] = " + Read(ins.Args[1], ValueTypes::Number) + ";\n";
+			break;
+
+		case OpCode::SaveStringGlobal:
+			if (hasArg1)
+			{
+				std::string literal = Program.IsConstant(ins.Args[1]) ? "true" : "false";
+				out += "\tinstance.SetStringGlobal(" + std::to_string(ins.Operand) + ", " + Slot(ins.Args[1]) + ", " + literal + ");\n";
+			}
+			break;
+
+		case OpCode::Delay:
+			Error = "delay nodes suspend the instance, which only the interpreter can do";
+			return false;
+
+		case OpCode::Native:
+			Error = std::string("node type ") + ins.Source->TypeName() + " has no generated form";
+			return false;
+
+		case OpCode::CompareBranch:
+		case OpCode::NumberGlobalUpdate:
+		case OpCode::LoopPrint:
+			// Unfuse turned superinstructions back into the plain instruction above, so these never get here
+			Error = "superinstruction reached the generator unfused";
+			return false;
+	}
+
+	out += "\t" + Target(ins.Next[0], context) + "\n";
+	return true;
+}
+
+bool Transpiler::EmitValues(uint32_t begin, uint32_t end, std::string& out)
+{
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const ValueOp& op = Program.ValueCode[i];
+		if (op.Op == ValueOpCode::Native)
+		{
+			Error = std::string("value node type ") + op.Source->TypeName() + " has no generated form";
+			return false;
+		}
+
+		std::string dest = Slot(op.Dest);
+		WrittenSlots.insert(op.Dest);
+
+		std::string operation = std::to_string(op.Operator);
+
+		switch (op.Op)
+		{
+			case ValueOpCode::Math:
+				out += "\t" + dest + ".SetNumber(Math::Evaluate(Math::Operation(" + operation + "), " + Read(op.A, ValueTypes::Number) + ", " + Read(op.B, ValueTypes::Number) + "));\n";
+				break;
+
+			case ValueOpCode::NumberComparison:
+				out += "\t" + dest + ".SetBool(NumberComparison::Evaluate(NumberComparison::Operation(" + operation + "), " + Read(op.A, ValueTypes::Number) + ", " + Read(op.B, ValueTypes::Number) + "));\n";
+				break;
+
+			case ValueOpCode::BooleanComparison:
+				out += "\t" + dest + ".SetBool(BooleanComparison::Evaluate(BooleanComparison::Operation(" + operation + "), " + Read(op.A, ValueTypes::Boolean) + ", " + Read(op.B, ValueTypes::Boolean) + "));\n";
+				break;
+
+			case ValueOpCode::Not:
+				out += "\t" + dest + ".SetBool(!" + Read(op.A, ValueTypes::Boolean) + ");\n";
+				break;
+
+			case ValueOpCode::LoadBool:
+				out += "\t" + dest + ".SetBool(instance.GetBool(" + Text(op.A, "name") + "));\n";
+				break;
+
+			case ValueOpCode::LoadNumber:
+				out += "\t" + dest + ".SetNumber(instance.GetNumber(" + Text(op.A, "name") + "));\n";
+				break;
+
+			case ValueOpCode::LoadString:
+			{
+				std::string text = "t" + std::to_string(op.Dest);
+				TextSlots.insert(op.Dest);
+				out += "\t" + text + " = instance.GetString(" + Text(op.A, "name") + ");\n";
+				out += "\t" + dest + ".SetString(&" + text + ");\n";
+				break;
+			}
+
+			case ValueOpCode::LoadBoolGlobal:
+				out += "\t" + dest + ".SetBool(instance.BoolGlobalSlots[" + std::to_string(op.A) + "] != 0);\n";
+				break;
+
+			case ValueOpCode::LoadNumberGlobal:
+				out += "\t" + dest + ".SetNumber(instance.NumGlobalSlots[" + std::to_string(op.A) + "]);\n";
+				break;
+
+			case ValueOpCode::LoadStringGlobal:
+				out += "\t" + dest + ".SetString(instance.StringGlobalSlots[" + std::to_string(op.A) + "]);\n";
+				break;
+
+			case ValueOpCode::LoopIndex:
+			{
+				std::string index = "loop" + std::to_string(op.NodeId);
+				LoopNodes.insert(op.NodeId);
+				out += "\t" + dest + ".SetNumber(" + index + " >= 0 ? float(" + index + ") : 0.0f);\n";
+				break;
+			}
+
+			case ValueOpCode::Convert:
+				if (ValueTypes(op.Operator) == ValueTypes::Boolean)
+					out += "\t" + dest + ".SetBool(" + Slot(op.A) + ".Boolean());\n";
+				else if (ValueTypes(op.Operator) == ValueTypes::Number)
+					out += "\t" + dest + ".SetNumber(" + Slot(op.A) + ".Number());\n";
+				else
+				{
+					TextSlots.insert(op.Dest);
+					out += "\t" + dest + ".SetString(&" + Slot(op.A) + ".String(t" + std::to_string(op.Dest) + "));\n";
+				}
+				break;
+
+			case ValueOpCode::Native:
+				break;
+		}
+	}
+
+	return true;
+}
+
+std::string Transpiler::Target(uint32_t pc, uint32_t context)
+{
+	// the end of a chain goes back to the loop that started it, or ends the run
+	if (pc == ScriptProgram::InvalidTarget)
+	{
+		if (context == 0)
+			return "return;";
+
+		const Context& loop = Contexts[context];
+		return Target(loop.LoopPc, loop.Parent);
+	}
+
+	std::pair<uint32_t, uint32_t> key(pc, context);
+	Referenced.insert(key);
+	if (Queued.insert(key).second)
+		Pending.push_back(key);
+
+	return "goto " + Label(pc, context) + ";";
+}
+
+uint32_t Transpiler::EnterLoop(uint32_t loopPc, uint32_t context)
+{
+	// a loop that cycles back into itself keeps growing the return stack, leave that to the interpreter
+	for (uint32_t i = context; i != uint32_t(-1); i = Contexts[i].Parent)
+	{
+		if (Contexts[i].LoopPc == loopPc)
+		{
+			Error = "a loop re-enters itself before completing";
+			return uint32_t(-1);
+		}
+	}
+
+	if (Contexts[context].Depth + 1 > MaxLoopDepth)
+	{
+		Error = "loops are nested too deeply";
+		return uint32_t(-1);
+	}
+
+	for (uint32_t i = 0; i < uint32_t(Contexts.size()); i++)
+	{
+		if (Contexts[i].LoopPc == loopPc && Contexts[i].Parent == context)
+			return i;
+	}
+
+	Context loop;
+	loop.LoopPc = loopPc;
+	loop.Parent = context;
+	loop.Depth = Contexts[context].Depth + 1;
+	Contexts.push_back(loop);
+	return uint32_t(Contexts.size() - 1);
+}
+
+std::string Transpiler::Slot(uint32_t slot)
+{
+	UsedSlots.insert(slot);
+	return "s" + std::to_string(slot);
+}
+
+std::string Transpiler::Read(uint32_t slot, ValueTypes type)
+{
+	// slots the compiler proved to always hold the type being read skip the coercion
+	std::string value = Slot(slot);
+	bool typed = Program.HasFixedType(slot) && Program.Slots[slot].Type == type;
+
+	if (type == ValueTypes::Boolean)
+		return value + (typed ? ".BoolValue" : ".Boolean()");
+	if (type == ValueTypes::Number)
+		return value + (typed ? ".NumberValue" : ".Number()");
+	return Text(slot, "text");
+}
+
+std::string Transpiler::Text(uint32_t slot, const char* scratch)
+{
+	UsesText = true;
+	return Slot(slot) + ".String(" + scratch + ")";
+}
+
+std::string Transpiler::Label(uint32_t pc, uint32_t context) const
+{
+	return "node" + std::to_string(Program.Code[pc].NodeId) + "_" + std::to_string(context);
+}
+
+std::string Transpiler::SlotDeclaration(uint32_t slot) const
+{
+	const ValueData& value = Program.Slots[slot];
+
+	std::string init;
+	switch (value.Type)
+	{
+		case ValueTypes::Boolean:
+			init = value.BoolValue ? "true" : "false";
+			break;
+		case ValueTypes::Number:
+			init = FormatFloat(value.NumberValue);
+			break;
+		case ValueTypes::String:
+			init = "std::string(" + QuoteString(*value.StringValue) + ", " + std::to_string(value.StringValue->size()) + ")";
+			break;
+	}
+
+	std::string name = "s" + std::to_string(slot);
+
+	// slots nothing writes to are the constants, strings are interned once rather than on every run
+	if (WrittenSlots.count(slot) && value.Type == ValueTypes::String)
+		return "\tstatic const ValueData " + name + "_initial(" + init + ");\n\tValueData " + name + " = " + name + "_initial;\n";
+	if (WrittenSlots.count(slot))
+		return "\tValueData " + name + "(" + init + ");\n";
+	if (value.Type == ValueTypes::String)
+		return "\tstatic const ValueData " + name + "(" + init + ");\n";
+	return "\tconst ValueData " + name + "(" + init + ");\n";
+}
+
+std::string Transpiler::FormatFloat(float value)
+{
+	if (std::isnan(value))
+		return "std::numeric_limits<float>::quiet_NaN()";
+	if (std::isinf(value))
+		return value < 0 ? "-std::numeric_limits<float>::infinity()" : "std::numeric_limits<float>::infinity()";
+
+	// 9 significant digits are enough to get the exact float back
+	char text[64] = { 0 };
+	snprintf(text, sizeof(text), "%.9g", value);
+
+	std::string literal = text;
+	if (literal.find_first_of(".e") == std::string::npos)
+		literal += ".0";
+
+	return literal + "f";
+}
+
+std::string Transpiler::QuoteString(const std::string& value)
+{
+	std::string quoted = "\"";
+	for (unsigned char c : value)
+	{
+		switch (c)
+		{
+			case '\\':
+				quoted += "\\\\";
+				break;
+			case '"':
+				quoted += "\\\"";
+				break;
+			case '\n':
+				quoted += "\\n";
+				break;
+			case '\t':
+				quoted += "\\t";
+				break;
+			default:
+				if (c >= 0x20 && c < 0x7f)
+				{
+					quoted += char(c);
+				}
+				else
+				{
+					char escape[8] = { 0 };
+					snprintf(escape, sizeof(escape), "\\%03o", c);
+					quoted += escape;
+				}
+				break;
+		}
+	}
+
+	return quoted + "\"";
+}
+
+std::string Transpiler::Identifier(const std::string& name)
+{
+	std::string identifier;
+	for (char c : name)
+		identifier += (isalnum((unsigned char)c) || c == '_') ? c : '_';
+
+	return identifier;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "script_graph.h"
+#include "script_program.h"
+
+#include <set>
+
+// turns the entry points of a compiled program into C++ functions that run the same operations without the interpreter
+class Transpiler
+{
+public:
+	Transpiler(const ScriptProgram& program);
+
+	// writes a whole source file, entries that can only run in the interpreter are skipped and listed in Skipped
+	std::string GenerateSource(const std::string& sourceName, const std::string& registerFunction);
+
+	std::vector<std::string> Skipped;
+
+protected:
+	const ScriptProgram& Program;
+
+	// the loops whose cycle output led here, a chain that ends goes back to the innermost one
+	struct Context
+	{
+		uint32_t LoopPc = ScriptProgram::InvalidTarget;
+		uint32_t Parent = uint32_t(-1);
+		uint32_t Depth = 0;
+	};
+
+	struct Block
+	{
+		uint32_t Pc = 0;
+		uint32_t Context = 0;
+		std::string Code;
+	};
+
+	static constexpr uint32_t MaxLoopDepth = 16;
+
+	std::vector<Context> Contexts;
+	std::vector<Block> Blocks;
+	std::vector<std::pair<uint32_t, uint32_t>> Pending;
+	std::set<std::pair<uint32_t, uint32_t>> Queued;
+	std::set<std::pair<uint32_t, uint32_t>> Referenced;
+	std::set<uint32_t> UsedSlots;
+	std::set<uint32_t> WrittenSlots;
+	std::set<uint32_t> TextSlots;
+	bool UsesText = false;
+	std::set<uint32_t> LoopNodes;
+	std::string Error;
+
+	bool GenerateEntry(uint32_t entryPc, const std::string& functionName, std::string& out);
+	bool EmitBlock(uint32_t pc, uint32_t context, std::string& out);
+	bool EmitValues(uint32_t begin, uint32_t end, std::string& out);
+
+	std::string Target(uint32_t pc, uint32_t context);
+	uint32_t EnterLoop(uint32_t loopPc, uint32_t context);
+
+	std::string Slot(uint32_t slot);
+	std::string Read(uint32_t slot, ValueTypes type);
+	std::string Text(uint32_t slot, const char* scratch);
+	std::string Label(uint32_t pc, uint32_t context) const;
+	std::string SlotDeclaration(uint32_t slot) const;
+
+	static std::string FormatFloat(float value);
+	static std::string QuoteString(const std::string& value);
+	static std::string Identifier(const std::string& name);
+};
@@ -0,0 +1,700 @@
+// Runs synthetic graphs through the interpreter and prints one CSV line per benchmark, for judging runtime changes
+//
+// script_bench [--warmup N] [--reps N] [--runs N] [--filter NAME] [--jit] [--no-fusion]
+// script_bench --serialize [--nodes N] [--reps N]
+//
+// columns
+//	name		the benchmark
+//	params		what the graph was generated with
+//	steps		instructions the interpreter dispatched per run, superinstructions count once
+//	values		values the steps read, each one a node evaluated
+//	runs		runs timed per repetition
+//	ns_run		median time of one run over the repetitions, ns_run_min the fastest
+//	ns_step		median time per dispatched instruction
+//	nodes_sec	steps and values per second at the median
+//	allocs_run	heap allocations per run, bytes_run the bytes they asked for
+//
+// --serialize times saving and loading graphs of 10k, 100k and 1M nodes instead, best of the repetitions
+//	nodes		nodes in the graph, bytes the size of its .script file
+//	write_ms	ScriptGraph::Write into a resource, read_ms ScriptGraph::Read back from it, which includes compile_ms
+//	save_ms		GraphSerializer::SaveScript to a file, load_ms GraphSerializer::LoadScript from it, round_trip_ms both
+//	*_mbs		megabytes of .script data per second
+//	*_allocs_node	operator new calls per node, resource buffers come from malloc and are not in these
+//	lossless	whether writing the loaded graph gives back the same resource as the original
+//	peak_mb		peak resident memory of the process so far
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "script_graph.h"
+#include "script_instrumentation.h"
+#include "script_program.h"
+
+#include "graph_serializer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// every heap allocation in the process goes through these, the timed runs read the counters.
+// each new has the delete that matches it, all of them end in the two functions below
+static uint64_t AllocationCount = 0;
+static uint64_t AllocationBytes = 0;
+
+#if defined(_MSC_VER)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+// kept out of line so the compiler does not pair a malloc it can see with the operator new that called it
+static BENCH_NOINLINE void* Allocate(size_t size, size_t alignment) noexcept
+{
+	AllocationCount++;
+	AllocationBytes += size;
+
+	if (size == 0)
+		size = 1;
+
+	if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		return malloc(size);
+
+#if defined(_WIN32)
+	return _aligned_malloc(size, alignment);
+#else
+	// aligned_alloc wants the size to be a multiple of the alignment
+	return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+}
+
+static BENCH_NOINLINE void Release(void* memory, size_t alignment) noexcept
+{
+#if defined(_WIN32)
+	if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+	{
+		_aligned_free(memory);
+		return;
+	}
+#else
+	(void)alignment;
+#endif
+	free(memory);
+}
+
+static void* AllocateOrThrow(size_t size, size_t alignment)
+{
+	void* memory = Allocate(size, alignment);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size) { return AllocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return AllocateOrThrow(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment) { return AllocateOrThrow(size, size_t(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return AllocateOrThrow(size, size_t(alignment)); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return Allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return Allocate(size, size_t(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return Allocate(size, size_t(alignment)); }
+
+void operator delete(void* memory) noexcept { Release(memory, 0); }
+void operator delete[](void* memory) noexcept { Release(memory, 0); }
+void operator delete(void* memory, size_t) noexcept { Release(memory, 0); }
+void operator delete[](void* memory, size_t) noexcept { Release(memory, 0); }
+void operator delete(void* memory, std::align_val_t alignment) noexcept { Release(memory, size_t(alignment)); }
+void operator delete[](void* memory, std::align_val_t alignment) noexcept { Release(memory, size_t(alignment)); }
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept { Release(memory, size_t(alignment)); }
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept { Release(memory, size_t(alignment)); }
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept { Release(memory, 0); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { Release(memory, 0); }
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept { Release(memory, size_t(alignment)); }
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept { Release(memory, size_t(alignment)); }
+
+struct BenchOptions
+{
+	int Warmup = 3;
+	// 0 picks the default for the mode
+	int Reps = 0;
+	int Runs = 20;
+	bool Serialize = false;
+	uint32_t Nodes = 0;
+	std::string Filter;
+	bool Jit = false;
+	bool Fusion = true;
+};
+
+struct Benchmark
+{
+	const char* Name;
+	void(*Build)(ScriptGraph& graph, int size, int iterations);
+	int Size;
+	int Iterations;
+};
+
+template<class T>
+T* Add(ScriptGraph& graph, T* node)
+{
+	graph.AddNode(node);
+	return node;
+}
+
+EntryNode* AddEntry(ScriptGraph& graph, const std::string& name)
+{
+	EntryNode* entry = Add(graph, new EntryNode());
+	entry->Name = name;
+	graph.EntryNodes[name] = entry;
+	return entry;
+}
+
+void Link(Node* from, size_t output, const Node* to)
+{
+	from->OutputNodeRefs[output].ID = to->ID;
+}
+
+void Bind(Node* node, size_t argument, const Node* from, uint32_t valueId = 0)
+{
+	node->Arguments[argument].ID = from->ID;
+	node->Arguments[argument].ValueId = valueId;
+}
+
+// a loop running the body, returns the loop so the body can read its index
+Loop* AddLoop(ScriptGraph& graph, Node* from, int iterations)
+{
+	Loop* loop = Add(graph, new Loop());
+	loop->Itterations = uint32_t(iterations);
+	Link(from, 0, loop);
+	return loop;
+}
+
+Node* AddMathTree(ScriptGraph& graph, int depth, const Node* index, int& leaf)
+{
+	if (depth == 0)
+	{
+		// every other leaf reads the loop index so the tree has to be worked out again each cycle
+		if (leaf++ % 2 == 0)
+			return const_cast<Node*>(index);
+
+		return Add(graph, new NumberLiteral(float(leaf % 7 + 1)));
+	}
+
+	static const Math::Operation operations[] = { Math::Operation::Add, Math::Operation::Multiply, Math::Operation::Subtract };
+	Math* math = Add(graph, new Math(operations[depth % 3]));
+	Bind(math, 0, AddMathTree(graph, depth - 1, index, leaf));
+	Bind(math, 1, AddMathTree(graph, depth - 1, index, leaf));
+	return math;
+}
+
+// a balanced tree of Math nodes, size levels deep, saved to a global every cycle
+void BuildMathTree(ScriptGraph& graph, int size, int iterations)
+{
+	EntryNode* entry = AddEntry(graph, "Entry");
+	Loop* loop = AddLoop(graph, entry, iterations);
+
+	SaveNumber* save = Add(graph, new SaveNumber());
+	Link(loop, 1, save);
+
+	int leaf = 0;
+	Bind(save, 0, Add(graph, new StringLiteral("result")));
+	Bind(save, 1, AddMathTree(graph, size, loop, leaf));
+}
+
+// size Conditions one after the other, each compares the loop index so the branches flip as the loop runs
+void BuildConditionChain(ScriptGraph& graph, int size, int iterations)
+{
+	EntryNode* entry = AddEntry(graph, "Entry");
+	Loop* loop = AddLoop(graph, entry, iterations);
+
+	// outputs that lead into the next condition
+	std::vector<std::pair<Node*, size_t>> open = { { loop, 1 } };
+	for (int i = 0; i < size; i++)
+	{
+		NumberComparison* compare = Add(graph, new NumberComparison(NumberComparison::Operation::GreaterThanEqual));
+		Bind(compare, 0, loop);
+		Bind(compare, 1, Add(graph, new NumberLiteral(float(i * iterations / size))));
+
+		Condition* condition = Add(graph, new Condition());
+		Bind(condition, 0, compare);
+
+		for (const auto& [from, output] : open)
+			Link(from, output, condition);
+
+		// the false branch writes a global before joining back into the chain
+		SaveNumber* save = Add(graph, new SaveNumber());
+		Bind(save, 0, Add(graph, new StringLiteral("misses")));
+		Bind(save, 1, loop);
+		Link(condition, 1, save);
+
+		open = { { condition, 0 }, { save, 0 } };
+	}
+}
+
+// size globals updated in sequence every cycle, each one from the one before it
+void BuildVariables(ScriptGraph& graph, int size, int iterations)
+{
+	EntryNode* entry = AddEntry(graph, "Entry");
+	Loop* loop = AddLoop(graph, entry, iterations);
+
+	Node* previous = loop;
+	size_t output = 1;
+	StringLiteral* lastName = nullptr;
+	for (int i = 0; i < size; i++)
+	{
+		StringLiteral* name = Add(graph, new StringLiteral("var" + std::to_string(i)));
+
+		Math* math = Add(graph, new Math(Math::Operation::Add));
+		Bind(math, 1, loop);
+		if (lastName)
+		{
+			LoadNumber* load = Add(graph, new LoadNumber());
+			Bind(load, 0, lastName);
+			Bind(math, 0, load);
+		}
+		else
+		{
+			Bind(math, 0, Add(graph, new NumberLiteral(1)));
+		}
+
+		SaveNumber* save = Add(graph, new SaveNumber());
+		Bind(save, 0, name);
+		Bind(save, 1, math);
+		Link(previous, output, save);
+
+		previous = save;
+		output = 0;
+		lastName = name;
+	}
+}
+
+// size entry points with a short body each, a run starts every one of them in turn
+void BuildEntryPoints(ScriptGraph& graph, int size, int iterations)
+{
+	for (int i = 0; i < size; i++)
+	{
+		EntryNode* entry = AddEntry(graph, "Entry" + std::to_string(i));
+
+		Node* previous = entry;
+		for (int n = 0; n < iterations; n++)
+		{
+			SaveNumber* save = Add(graph, new SaveNumber());
+			Bind(save, 0, Add(graph, new StringLiteral("entry" + std::to_string(i))));
+			Bind(save, 1, Add(graph, new NumberLiteral(float(n))));
+			Link(previous, 0, save);
+			previous = save;
+		}
+	}
+}
+
+// strings of size characters copied through globals and logged every cycle
+void BuildStrings(ScriptGraph& graph, int size, int iterations)
+{
+	EntryNode* entry = AddEntry(graph, "Entry");
+	Loop* loop = AddLoop(graph, entry, iterations);
+
+	StringLiteral* text = Add(graph, new StringLiteral(std::string(size_t(size), 'x')));
+	StringLiteral* textName = Add(graph, new StringLiteral("text"));
+	StringLiteral* copyName = Add(graph, new StringLiteral("copy"));
+
+	SaveString* save = Add(graph, new SaveString());
+	Bind(save, 0, textName);
+	Bind(save, 1, text);
+	Link(loop, 1, save);
+
+	LoadString* load = Add(graph, new LoadString());
+	Bind(load, 0, textName);
+
+	SaveString* copy = Add(graph, new SaveString());
+	Bind(copy, 0, copyName);
+	Bind(copy, 1, load);
+	Link(save, 0, copy);
+
+	LoadString* loadCopy = Add(graph, new LoadString());
+	Bind(loadCopy, 0, copyName);
+
+	PrintLog* log = Add(graph, new PrintLog());
+	Bind(log, 0, loadCopy);
+	Link(copy, 0, log);
+}
+
+const Benchmark Benchmarks[] =
+{
+	{ "math_tree", BuildMathTree, 8, 200 },
+	{ "condition_chain", BuildConditionChain, 64, 1000 },
+	{ "variables", BuildVariables, 32, 1000 },
+	{ "entry_points", BuildEntryPoints, 256, 4 },
+	{ "strings", BuildStrings, 4096, 1000 },
+};
+
+std::vector<ScriptGraph::EntryHandle> GetEntries(const ScriptGraph& graph)
+{
+	std::vector<ScriptGraph::EntryHandle> entries;
+	for (const auto& [name, node] : graph.EntryNodes)
+		entries.push_back(graph.GetEntryHandle(name));
+	return entries;
+}
+
+// one run starts every entry point of the graph once
+void RunAll(ScriptInstance& instance, const std::vector<ScriptGraph::EntryHandle>& entries)
+{
+	for (ScriptGraph::EntryHandle entry : entries)
+		instance.Run(entry);
+}
+
+// one counted run, outside the timings since counting sends every run through the interpreter
+void CountRun(const ScriptGraph& graph, const std::vector<ScriptGraph::EntryHandle>& entries, uint64_t& steps, uint64_t& values)
+{
+	ScriptCounters counters;
+	ScriptInstance instance(graph);
+	instance.Counters = &counters;
+	RunAll(instance, entries);
+
+	steps = 0;
+	for (uint64_t count : counters.Instructions)
+		steps += count;
+	values = counters.ValueReads;
+}
+
+void RunBenchmark(const Benchmark& bench, const BenchOptions& options)
+{
+	ScriptGraph graph;
+	graph.UseFusion = options.Fusion;
+	graph.UseJit = options.Jit;
+	bench.Build(graph, bench.Size, bench.Iterations);
+	graph.Compile();
+
+	for (const std::string& error : graph.VerifyErrors)
+		fprintf(stderr, "%s: %s\n", bench.Name, error.c_str());
+
+	std::vector<ScriptGraph::EntryHandle> entries = GetEntries(graph);
+	uint64_t steps = 0;
+	uint64_t values = 0;
+	CountRun(graph, entries, steps, values);
+
+	ScriptInstance instance(graph);
+
+	for (int i = 0; i < options.Warmup; i++)
+		RunAll(instance, entries);
+
+	std::vector<double> times;
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+	for (int rep = 0; rep < options.Reps; rep++)
+	{
+		uint64_t startCount = AllocationCount;
+		uint64_t startBytes = AllocationBytes;
+		auto start = std::chrono::steady_clock::now();
+
+		for (int run = 0; run < options.Runs; run++)
+			RunAll(instance, entries);
+
+		auto end = std::chrono::steady_clock::now();
+		allocations += AllocationCount - startCount;
+		bytes += AllocationBytes - startBytes;
+
+		times.push_back(std::chrono::duration<double, std::nano>(end - start).count() / options.Runs);
+	}
+
+	std::sort(times.begin(), times.end());
+	double median = times[times.size() / 2];
+	double totalRuns = double(options.Reps) * options.Runs;
+
+	uint64_t nodes = steps + values;
+
+	printf("%s,size=%d iterations=%d%s%s,%llu,%llu,%d,%.0f,%.0f,%.3f,%.0f,%.2f,%.0f\n",
+		bench.Name, bench.Size, bench.Iterations, options.Fusion ? "" : " no-fusion", options.Jit ? " jit" : "",
+		(unsigned long long)steps, (unsigned long long)values, options.Runs, median, times.front(),
+		steps ? median / steps : 0.0, median > 0 ? nodes * 1e9 / median : 0.0,
+		allocations / totalRuns, bytes / totalRuns);
+	fflush(stdout);
+
+	for (const auto& [id, node] : graph.Nodes)
+		delete node;
+}
+
+template<class T>
+T* Create(ScriptGraph& graph)
+{
+	T* node = static_cast<T*>(NodeRegistry::CreateNode<T>());
+	graph.AddNode(node);
+	return node;
+}
+
+// blocks of a compare, branch, variable update and log, a new entry point every hundred blocks
+void BuildSerializationGraph(ScriptGraph& graph, uint32_t nodes)
+{
+	Node* previous = nullptr;
+	for (uint32_t block = 0; graph.Nodes.size() < nodes; block++)
+	{
+		if (block % 100 == 0)
+		{
+			EntryNode* entry = Create<EntryNode>(graph);
+			entry->Name = "Entry" + std::to_string(block / 100);
+			graph.EntryNodes[entry->Name] = entry;
+			previous = entry;
+		}
+
+		StringLiteral* name = Create<StringLiteral>(graph);
+		name->SetValue("var" + std::to_string(block % 1000));
+
+		LoadNumber* load = Create<LoadNumber>(graph);
+		Bind(load, 0, name);
+
+		NumberLiteral* limit = Create<NumberLiteral>(graph);
+		limit->SetValue(float(block));
+
+		NumberComparison* compare = Create<NumberComparison>(graph);
+		compare->Operator = NumberComparison::Operation(block % int(NumberComparison::Operation::LAST_OP));
+		Bind(compare, 0, load);
+		Bind(compare, 1, limit);
+
+		Condition* condition = Create<Condition>(graph);
+		Bind(condition, 0, compare);
+		Link(previous, 0, condition);
+
+		Math* math = Create<Math>(graph);
+		math->Operator = Math::Operation(block % int(Math::Operation::LAST_OP));
+		Bind(math, 0, load);
+		Bind(math, 1, limit);
+
+		SaveNumber* save = Create<SaveNumber>(graph);
+		Bind(save, 0, name);
+		Bind(save, 1, math);
+		Link(condition, 0, save);
+
+		StringLiteral* text = Create<StringLiteral>(graph);
+		text->SetValue("block " + std::to_string(block));
+
+		PrintLog* log = Create<PrintLog>(graph);
+		Bind(log, 0, text);
+		Link(condition, 1, log);
+
+		// both branches carry on into the next block
+		Link(save, 0, log);
+		previous = log;
+	}
+}
+
+void DeleteNodes(ScriptGraph& graph)
+{
+	for (const auto& [id, node] : graph.Nodes)
+		delete node;
+	graph.Nodes.clear();
+}
+
+size_t GetFileSize(const ScriptResource& resource)
+{
+	size_t size = 4;
+	for (const NodeResource& res : resource.Nodes)
+		size += 4 + 1 + NodeResource::MaxNodeName * 2 + 4 + res.DataSize;
+	return size;
+}
+
+bool SameResources(const ScriptResource& a, const ScriptResource& b)
+{
+	if (a.Nodes.size() != b.Nodes.size())
+		return false;
+
+	for (size_t i = 0; i < a.Nodes.size(); i++)
+	{
+		const NodeResource& x = a.Nodes[i];
+		const NodeResource& y = b.Nodes[i];
+		if (x.ID != y.ID || x.EntryPoint != y.EntryPoint || x.DataSize != y.DataSize)
+			return false;
+
+		if (memcmp(x.TypeName, y.TypeName, sizeof(x.TypeName)) != 0 || memcmp(x.Name, y.Name, sizeof(x.Name)) != 0)
+			return false;
+
+		if (x.DataSize > 0 && memcmp(x.Data, y.Data, x.DataSize) != 0)
+			return false;
+	}
+	return true;
+}
+
+double GetPeakMegabytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+	return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+	return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+// the best time of every repetition of one operation, with the allocations of the last one
+struct OperationTime
+{
+	double Milliseconds = 0;
+	uint64_t Allocations = 0;
+
+	// after runs outside the timings once each repetition is done
+	template<class Function, class After>
+	void Measure(int reps, Function&& function, After&& after)
+	{
+		for (int rep = 0; rep < reps; rep++)
+		{
+			uint64_t startCount = AllocationCount;
+			auto start = std::chrono::steady_clock::now();
+
+			function();
+
+			auto end = std::chrono::steady_clock::now();
+			Allocations = AllocationCount - startCount;
+
+			double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+			if (rep == 0 || milliseconds < Milliseconds)
+				Milliseconds = milliseconds;
+
+			after();
+		}
+	}
+};
+
+void RunSerialization(uint32_t nodes, const BenchOptions& options)
+{
+	const std::string path = "script_bench.script";
+
+	ScriptGraph graph;
+	BuildSerializationGraph(graph, nodes);
+
+	ScriptResource original;
+	graph.Write(original);
+	size_t bytes = GetFileSize(original);
+	bool lossless = true;
+
+	// writes the loaded graph back out to compare with the original, then frees it
+	ScriptGraph loaded;
+	auto check = [&]()
+	{
+		ScriptResource resource;
+		loaded.Write(resource);
+		lossless &= SameResources(original, resource);
+		DeleteNodes(loaded);
+	};
+
+	OperationTime write;
+	write.Measure(options.Reps, [&]() { ScriptResource resource; graph.Write(resource); }, []() {});
+
+	OperationTime read;
+	read.Measure(options.Reps, [&]() { loaded.Read(original); }, check);
+
+	loaded.Read(original);
+	OperationTime compile;
+	compile.Measure(options.Reps, [&]() { loaded.Compile(); }, []() {});
+	check();
+
+	OperationTime save;
+	save.Measure(options.Reps, [&]() { lossless &= GraphSerializer::SaveScript(graph, path); }, []() {});
+
+	OperationTime load;
+	load.Measure(options.Reps, [&]() { loaded = GraphSerializer::LoadScript(path); }, check);
+
+	remove(path.c_str());
+
+	auto megabytesPerSecond = [bytes](double milliseconds) { return milliseconds > 0 ? bytes / (1024.0 * 1024.0) / (milliseconds / 1000.0) : 0.0; };
+	auto perNode = [nodes](uint64_t allocations) { return double(allocations) / nodes; };
+
+	printf("%u,%llu,%.2f,%.1f,%.2f,%.2f,%.1f,%.2f,%.2f,%.2f,%.1f,%.2f,%.1f,%.2f,%.2f,%s,%.1f\n",
+		uint32_t(graph.Nodes.size()), (unsigned long long)bytes,
+		write.Milliseconds, megabytesPerSecond(write.Milliseconds), perNode(write.Allocations),
+		read.Milliseconds, megabytesPerSecond(read.Milliseconds), perNode(read.Allocations),
+		compile.Milliseconds,
+		save.Milliseconds, megabytesPerSecond(save.Milliseconds),
+		load.Milliseconds, megabytesPerSecond(load.Milliseconds), perNode(load.Allocations),
+		save.Milliseconds + load.Milliseconds, lossless ? "yes" : "no", GetPeakMegabytes());
+	fflush(stdout);
+
+	DeleteNodes(graph);
+}
+
+int main(int argc, char* argv[])
+{
+	NodeRegistry::RegisterDefaultNodes();
+
+	BenchOptions options;
+	for (int i = 1; i < argc; i++)
+	{
+		auto number = [&](int& value)
+		{
+			if (i + 1 < argc)
+				value = std::max(1, atoi(argv[++i]));
+		};
+
+		if (strcmp(argv[i], "--warmup") == 0)
+			number(options.Warmup);
+		else if (strcmp(argv[i], "--reps") == 0)
+			number(options.Reps);
+		else if (strcmp(argv[i], "--runs") == 0)
+			number(options.Runs);
+		else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			options.Filter = argv[++i];
+		else if (strcmp(argv[i], "--jit") == 0)
+			options.Jit = true;
+		else if (strcmp(argv[i], "--no-fusion") == 0)
+			options.Fusion = false;
+		else if (strcmp(argv[i], "--serialize") == 0)
+			options.Serialize = true;
+		else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc)
+			options.Nodes = uint32_t(std::max(1, atoi(argv[++i])));
+		else
+		{
+			fprintf(stderr, "usage: script_bench [--warmup N] [--reps N] [--runs N] [--filter NAME] [--jit] [--no-fusion]\n");
+			fprintf(stderr, "       script_bench --serialize [--nodes N] [--reps N]\n");
+			return 1;
+		}
+	}
+
+	if (options.Serialize)
+	{
+		if (options.Reps == 0)
+			options.Reps = 3;
+
+		printf("nodes,bytes,write_ms,write_mbs,write_allocs_node,read_ms,read_mbs,read_allocs_node,compile_ms,"
+			"save_ms,save_mbs,load_ms,load_mbs,load_allocs_node,round_trip_ms,lossless,peak_mb\n");
+
+		if (options.Nodes > 0)
+		{
+			RunSerialization(options.Nodes, options);
+		}
+		else
+		{
+			for (uint32_t nodes : { 10000u, 100000u, 1000000u })
+				RunSerialization(nodes, options);
+		}
+		return 0;
+	}
+
+	if (options.Reps == 0)
+		options.Reps = 10;
+
+	// the string benchmark logs every cycle, the output is not what is being measured
+	size_t logged = 0;
+	PrintLog::LogFunction = [&logged](const std::string& text) { logged += text.size(); };
+
+	printf("name,params,steps,values,runs,ns_run,ns_run_min,ns_step,nodes_sec,allocs_run,bytes_run\n");
+	for (const Benchmark& bench : Benchmarks)
+	{
+		if (options.Filter.empty() || options.Filter == bench.Name)
+			RunBenchmark(bench, options);
+	}
+
+	return 0;
+}
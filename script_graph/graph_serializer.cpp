@@ -0,0 +1,98 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "graph_serializer.h"
+
+namespace GraphSerializer
+{
+	bool SaveScript(const ScriptGraph& graph, const std::string& filename)
+	{
+		ScriptResource scriptRes;
+		graph.Write(scriptRes);
+
+		FILE* fp = fopen(filename.c_str(), "wb");
+		if (!fp)
+			return false;
+
+		uint32_t count = uint32_t(scriptRes.Nodes.size());
+
+		fwrite(&count, 4, 1, fp);
+
+		for (const auto& res : scriptRes.Nodes)
+		{
+			fwrite(&res.ID, 4, 1, fp);
+
+			unsigned char isEntry = res.EntryPoint ? 1 : 0;
+			fwrite(&isEntry, 1, 1, fp);
+
+			fwrite(res.TypeName, NodeResource::MaxNodeName, 1, fp);
+			fwrite(res.Name, NodeResource::MaxNodeName, 1, fp);
+
+			uint32_t size = uint32_t(res.DataSize);
+			fwrite(&size, 4, 1, fp);
+			fwrite(res.Data, res.DataSize, 1, fp);
+		}
+
+		bool ok = !ferror(fp);
+		fclose(fp);
+		return ok;
+	}
+
+	ScriptGraph LoadScript(const std::string& filename)
+	{
+		ScriptGraph script;
+		FILE* fp = fopen(filename.c_str(), "rb");
+		if (!fp)
+			return script;
+
+		// node sizes are checked against what is left of the file, so a damaged one cannot ask for a huge block
+		fseek(fp, 0, SEEK_END);
+		long fileSize = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+
+		auto read = [fp](void* data, size_t size) { return size == 0 || fread(data, size, 1, fp) == 1; };
+
+		ScriptResource res;
+		uint32_t count = 0;
+		bool ok = fileSize >= 0 && read(&count, 4);
+
+		for (uint32_t i = 0; ok && i < count; i++)
+		{
+			NodeResource nodeRes;
+			unsigned char isEntry = 0;
+			uint32_t size = 0;
+
+			ok = read(&nodeRes.ID, 4)
+				&& read(&isEntry, 1)
+				&& read(nodeRes.TypeName, NodeResource::MaxNodeName)
+				&& read(nodeRes.Name, NodeResource::MaxNodeName)
+				&& read(&size, 4)
+				&& size <= size_t(fileSize - ftell(fp));
+			if (!ok)
+				break;
+
+			nodeRes.EntryPoint = isEntry != 0;
+			nodeRes.TypeName[NodeResource::MaxNodeName - 1] = 0;
+			nodeRes.Name[NodeResource::MaxNodeName - 1] = 0;
+
+			nodeRes.DataSize = size_t(size);
+			nodeRes.Data = malloc(size > 0 ? size : 1);
+			if (!nodeRes.Data)
+			{
+				ok = false;
+				break;
+			}
+
+			// the resource owns the data from here, so it is freed however the load ends
+			res.Nodes.emplace_back(std::move(nodeRes));
+			ok = read(res.Nodes.back().Data, size);
+		}
+
+		fclose(fp);
+
+		// a short read means the file was cut off or is damaged, none of it is used
+		if (ok)
+			script.Read(res);
+
+		return script;
+	}
+}
@@ -2,7 +2,11 @@
 
 #include "script_graph.h"
 
-namespace GraphReader
+// .script files, a node count then each node's ID, entry flag, type name, name and data
+namespace GraphSerializer
 {
+	bool SaveScript(const ScriptGraph& graph, const std::string& filename);
 
-}
\ No newline at end of file
+	// an empty graph when the file can not be opened, the graph comes back compiled
+	ScriptGraph LoadScript(const std::string& filename);
+}
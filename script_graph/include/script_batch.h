@@ -0,0 +1,95 @@
+#pragma once
+
+#include "script_program.h"
+
+// runs one entry point of one graph across many instances in lockstep
+// numbers and bools live in one row of lanes per slot so value nodes are evaluated for every instance at once,
+// lanes that take different branches split into groups with their own lane masks
+class ScriptBatch
+{
+public:
+	struct BatchStats
+	{
+		uint32_t Lanes = 0;
+		uint32_t Completed = 0;
+
+		// instructions run for a whole group at once
+		uint64_t Instructions = 0;
+
+		uint32_t Splits = 0;
+		uint32_t Merges = 0;
+
+		// lanes that finished in the scalar interpreter
+		uint32_t ScalarLanes = 0;
+	};
+
+	ScriptBatch(const ScriptGraph& graph);
+
+	// every instance must belong to the graph and not be running, results line up with the instances
+	const BatchStats& Run(ScriptGraph::EntryHandle entryPoint, const std::vector<ScriptInstance*>& instances);
+
+	std::vector<ScriptInstance::Result> Results;
+
+	// past this many groups, or below this many lanes in a group, the lanes finish one at a time in the interpreter
+	uint32_t MaxGroups = 8;
+	uint32_t MinGroupLanes = 4;
+
+	inline const BatchStats& GetStats() const { return Stats; }
+
+protected:
+	enum class SlotKind : uint8_t
+	{
+		None,
+		Lane,
+		String,
+	};
+
+	// lanes that are all at the same instruction with the same loop state and return stack
+	struct Group
+	{
+		uint32_t Pc = ScriptProgram::InvalidTarget;
+		std::vector<uint32_t> Mask;
+		uint32_t Count = 0;
+		uint32_t Begin = 0;
+		uint32_t End = 0;
+
+		std::vector<uint32_t> ReturnStack;
+		std::vector<int32_t> LoopFrames;
+	};
+
+	const ScriptGraph& Graph;
+	std::shared_ptr<const ScriptProgram> Program;
+
+	std::vector<SlotKind> SlotKinds;
+	std::vector<uint32_t> LaneRows;
+	std::vector<uint32_t> LaneSlots;
+	std::vector<bool> Batchable;
+
+	// slot rows of lanes, padded to a whole number of vectors
+	std::vector<float> Lanes;
+	uint32_t Stride = 0;
+
+	std::vector<Group> Groups;
+	const std::vector<ScriptInstance*>* Instances = nullptr;
+	BatchStats Stats;
+
+	void Prepare();
+	bool CanBatch(const Instruction& ins) const;
+	bool CanBatch(const ValueOp& op) const;
+	bool IsLane(uint32_t slot) const;
+	bool IsString(uint32_t slot) const;
+
+	void Step(size_t groupIndex);
+	void EvaluateValues(Group& group, uint32_t begin, uint32_t end);
+	void Split(size_t groupIndex, uint32_t slot, uint32_t whenTrue, uint32_t whenFalse, bool pushLoop);
+	void SetNext(Group& group, uint32_t next);
+	size_t MergeGroups(size_t groupIndex);
+	void UpdateRange(Group& group);
+
+	void Finish(Group& group);
+	void RunScalar(Group& group);
+	void WriteBack(uint32_t lane);
+
+	inline float* Row(uint32_t slot) { return Lanes.data() + size_t(LaneRows[slot]) * Stride; }
+	ValueData GetLaneValue(uint32_t slot, uint32_t lane);
+};
@@ -5,10 +5,23 @@
 #include <stdint.h>
 #include <map>
 #include <unordered_map>
-#include <stack>
+#include <deque>
 #include <functional>
+#include <memory>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
 
 class Node;
+class ScriptProgram;
+class ScriptInstance;
+class ScriptProfiler;
+class ScriptCounters;
+class ScriptDebugger;
+class ScriptSampler;
+class ScriptSnapshot;
+struct SnapshotStrings;
 namespace NodeRegistry
 {
 	void RegisterNode(const char* typeName, std::function<Node* ()> newFactory, std::function<Node* (void*, size_t)> loadFactory);
@@ -40,6 +53,12 @@ namespace NodeRegistry
 	std::vector<std::string> GetNodeList();
 
 	const std::string& GetNodeTypeFromIndex(size_t index);
+
+	// entry points translated to C++ ahead of time, matched to a program by its hash when it is compiled
+	using PrecompiledEntry = void(*)(ScriptInstance&);
+
+	void RegisterPrecompiledEntry(uint64_t programHash, const char* entryName, PrecompiledEntry function);
+	PrecompiledEntry FindPrecompiledEntry(uint64_t programHash, const std::string& entryName);
 }
 
 class NodeRef
@@ -48,6 +67,9 @@ public:
 	uint32_t ID = uint32_t(-1);
 	std::string Name;
 
+	// compact index into ScriptGraph::NodeTable, resolved when the graph is compiled
+	uint32_t Index = uint32_t(-1);
+
 	NodeRef() = default;
 
 	NodeRef(const std::string& name)
@@ -92,65 +114,85 @@ public:
 	}
 };
 
-class ValueData
+// interned strings are never freed, so values can point at them without owning them
+// only names and literals are interned, when a graph is loaded or compiled, text made while running lives in the instance
+namespace StringPool
 {
-public:
-	ValueTypes Type;
-
-	virtual const bool& Boolean() const = 0;
-	virtual const float& Number() const = 0;
-	virtual const std::string& String() const = 0;
-
-	virtual ~ValueData() = default;
-};
+	const std::string* Intern(const std::string& text);
+	const std::string* Empty();
+}
 
-class BooleanValueData : public ValueData
+// a compact tagged value, coercions are inline and never touch shared storage
+class ValueData
 {
 public:
-	bool Value = 0;
-	BooleanValueData(bool val) : Value(val) { Type = ValueTypes::Boolean; }
-	const bool& Boolean() const override { return Value; }
-	const float& Number() const override { return Value ? TrueF : FalseF; }
-	const std::string& String() const override { return Value ? TrueS : FalseS; }
+	ValueTypes Type = ValueTypes::Number;
 
-protected:
-	float TrueF = 1.0f;
-	float FalseF = 0.0f;
+	union
+	{
+		bool BoolValue;
+		float NumberValue = 0;
+		const std::string* StringValue;
+	};
 
-	const std::string TrueS = "true";
-	const std::string FalseS = "true";
-};
+	ValueData() = default;
+	explicit ValueData(bool value) { SetBool(value); }
+	explicit ValueData(float value) { SetNumber(value); }
+	explicit ValueData(const std::string& value) { SetString(value); }
 
-class NumberValueData : public ValueData
-{
-public:
-	float Value = 0;
-	NumberValueData(float val) : Value(val) { Type = ValueTypes::Number; }
-	const bool& Boolean() const override { return Value != 0 ? TrueB : FalseB; }
-	const float& Number() const override { return Value; }
-	const std::string& String() const override { Text = std::to_string(Value); return Text; }
+	inline void SetBool(bool value) { Type = ValueTypes::Boolean; BoolValue = value; }
+	inline void SetNumber(float value) { Type = ValueTypes::Number; NumberValue = value; }
+	inline void SetString(const std::string* interned) { Type = ValueTypes::String; StringValue = interned; }
 
-protected:
-	bool TrueB = true;
-	bool FalseB = false;
-
-	static std::string Text;
-};
+	// interns the text, for literals and names at load or compile time, strings made while running use ScriptInstance::SetValueString
+	inline void SetString(const std::string& value) { SetString(StringPool::Intern(value)); }
 
-class StringValueData : public ValueData
-{
-public:
-	std::string Value = 0;
-	StringValueData(const std::string& val) : Value(val) { Type = ValueTypes::String; }
-	const bool& Boolean() const override { return Value != "false" ? TrueB : FalseB; }
-	const float& Number() const override { ValueF = float(atof(Value.c_str())); return ValueF; }
-	const std::string& String() const override { return Value; }
+	inline bool Boolean() const
+	{
+		switch (Type)
+		{
+			case ValueTypes::Boolean:
+				return BoolValue;
+			case ValueTypes::Number:
+				return NumberValue != 0;
+			default:
+				return *StringValue != "false";
+		}
+	}
 
-protected:
-	bool TrueB = true;
-	bool FalseB = false;
+	inline float Number() const
+	{
+		switch (Type)
+		{
+			case ValueTypes::Boolean:
+				return BoolValue ? 1.0f : 0.0f;
+			case ValueTypes::Number:
+				return NumberValue;
+			default:
+				return float(atof(StringValue->c_str()));
+		}
+	}
 
-	static float ValueF;
+	// strings come back as they are, bools and numbers are written into scratch, which keeps its capacity between calls
+	inline const std::string& String(std::string& scratch) const
+	{
+		switch (Type)
+		{
+			case ValueTypes::Boolean:
+				scratch = BoolValue ? "true" : "false";
+				return scratch;
+			case ValueTypes::Number:
+			{
+				// the same text std::to_string gives
+				char text[64];
+				snprintf(text, sizeof(text), "%f", NumberValue);
+				scratch = text;
+				return scratch;
+			}
+			default:
+				return *StringValue;
+		}
+	}
 };
 
 class ScriptInstance;
@@ -169,9 +211,19 @@ public:
 
 	std::vector<ValueDef> Values;
 
-	virtual const NodeRef* Process(ScriptInstance& state) { return nullptr; }
+	// nodes are shared by every instance of a graph, anything that changes while running belongs in the instance
+	virtual const NodeRef* Process(ScriptInstance& state) const { return nullptr; }
+
+	virtual const ValueData* GetValue(uint32_t id, ScriptInstance& state) const { return nullptr; }
 
-	virtual const ValueData* GetValue(uint32_t id, ScriptInstance& state) { return nullptr; }
+	// pure values only depend on their arguments, so they can be cached for the rest of a step
+	virtual bool IsPure() const { return false; }
+
+	// values that read globals can be cached until the next global write
+	virtual bool ReadsGlobals() const { return false; }
+
+	// whether reading a value reads the arguments, nodes that keep their own state can sit in a cycle of values
+	virtual bool ValuesUseArguments() const { return true; }
 
 	virtual const char* TypeName() const = 0;
 
@@ -182,6 +234,9 @@ public:
 	virtual size_t GetDataSize();
 	virtual bool Write(void* data, size_t& offset);
 
+	// why the saved data did not fit this node type, empty when it loaded cleanly
+	std::string LoadError;
+
 protected:
 	void WriteBool(bool value, void* data, size_t& offset);
 	void WriteUInt(uint32_t value, void* data, size_t& offset);
@@ -190,8 +245,11 @@ protected:
 	void WriteString(const std::string& value, void* data, size_t& offset);
 	size_t GetStringDataSize(const std::string& value) { return 4 + value.size(); }
 
+	// reads past the end of the data give zeros and set LoadError
+	bool ReadData(void* value, size_t valueSize, void* data, size_t size, size_t& offset);
 	bool ReadBool(void* data, size_t size, size_t& offset);
 	uint32_t ReadUInt(void* data, size_t size, size_t& offset);
+	uint32_t ReadCount(void* data, size_t size, size_t& offset);
 	float ReadFloat(void* data, size_t size, size_t& offset);
 	std::string ReadString(void* data, size_t size, size_t& offset);
 };
@@ -232,53 +290,254 @@ static Node* Load(void* data, size_t size) { Node* node = new TYPE(); size_t off
 class ScriptGraph
 {
 public:
+	// dense index of an entry point, stays valid across compiles until entry nodes are added or removed
+	using EntryHandle = uint32_t;
+	static constexpr EntryHandle InvalidEntry = uint32_t(-1);
+
+	// editor facing storage, keyed by IDs that never change once assigned
 	std::map<uint32_t,Node*> Nodes;
 
 	std::map<std::string, Node*> EntryNodes;
 
+	// the same nodes stored contiguously, every ref's Index points in here
+	std::vector<Node*> NodeTable;
+
+	inline Node* GetNode(const NodeRef& ref) const
+	{
+		if (ref.Index < NodeTable.size() && NodeTable[ref.Index]->ID == ref.ID)
+			return NodeTable[ref.Index];
+
+		// the ref was edited since the last compile
+		return FindNode(ref.ID);
+	}
+
+	// only for graphs that passed Verify, where every index is known to match its ID
+	inline Node* GetVerifiedNode(const NodeRef& ref) const
+	{
+		return ref.Index < NodeTable.size() ? NodeTable[ref.Index] : nullptr;
+	}
+
+	Node* FindNode(uint32_t id) const;
+
 	void Write(ScriptResource& resource) const;
 
 	bool Read(const ScriptResource& package);
 
 	uint32_t AddNode(Node* node);
+
+	// lowers the graph into a flat program, must be called again after the graph is edited
+	void Compile();
+
+	// the program instances run, compiled the first time it is asked for when Compile was not called since the last edit.
+	// instances starting on many threads at once share one compile
+	const std::shared_ptr<const ScriptProgram>& GetCompiledProgram() const;
+
+	// checks every ref points at a node, every argument reads a value that node has, node data matched its type
+	// and no value depends on itself, graphs that pass run without the per lookup checks
+	bool Verify();
+	std::vector<std::string> VerifyErrors;
+
+	// turns common chains of nodes into superinstructions when compiling
+	bool UseFusion = true;
+
+	// also writes machine code for the entry points when compiling, only on Linux x86-64
+	bool UseJit = false;
+	const std::shared_ptr<const ScriptProgram>& GetProgram() const { return Program; }
+
+	EntryHandle GetEntryHandle(const std::string& name) const;
+
+protected:
+	std::shared_ptr<const ScriptProgram> Program;
+
+	void ResolveNodeRefs();
 };
 
 class ScriptInstance
 {
 public:
-	ScriptInstance(ScriptGraph& graph);
+	ScriptInstance(const ScriptGraph& graph);
 	enum class Result
 	{
 		Error,
 		Complete,
 		Incomplete,
+		Waiting,
+	};
+
+	// how far a bounded step got
+	struct StepResult
+	{
+		Result Status = Result::Complete;
+		uint32_t NodesRun = 0;
 	};
 
 	Result Run(const std::string& entryPoint);
+	Result Run(ScriptGraph::EntryHandle entryPoint);
 
 	ScriptInstance::Result Start(const std::string& entryPoint);
+	ScriptInstance::Result Start(ScriptGraph::EntryHandle entryPoint);
 	ScriptInstance::Result Step();
 
+	// runs at most maxNodes nodes
+	StepResult Step(uint32_t maxNodes);
+
+	// runs nodes until the script finishes or the deadline passes, may overshoot by one slice of nodes
+	StepResult StepFor(std::chrono::steady_clock::time_point deadline);
+	StepResult StepFor(std::chrono::microseconds budget);
+
 	const ValueData* GetValue(const ValueRef& ref);
 
+	// where a node writes its output values, laid out per instance by the compiled program
+	ValueData& GetNodeValue(const Node& node, uint32_t valueId);
+
+	// drops every cached value, call after changing globals from outside the script
+	void InvalidateValues();
+
+	// captures or puts back the globals, loop counters and where the script is, see script_snapshot.h
+	// a restore fails when the snapshot was taken from another graph or before the graph was last compiled
+	ScriptSnapshot Snapshot() const;
+	bool Restore(const ScriptSnapshot& snapshot);
+
+	// a new instance of the same graph starting from this one's state and settings, instrumentation is not carried over
+	std::unique_ptr<ScriptInstance> Fork() const;
+	std::unique_ptr<ScriptInstance> Fork(const ScriptSnapshot& snapshot) const;
+
 	void PushReturnNode();
 
+	// the counter a loop node keeps for this instance, -1 until its first cycle
+	int32_t& GetLoopIndex(const Node& node);
+
+	// parks the script after the current node, it stays put until Resume is called
+	void Suspend(float seconds);
+	void Resume();
+	inline bool IsWaiting() const { return Waiting; }
+	inline float GetWaitSeconds() const { return WaitSeconds; }
+
+	// name based access to globals, works for both compile time bound and dynamic names,
+	// the text GetString returns stays valid until the global is next written
+	bool GetBool(const std::string& name) const;
+	float GetNumber(const std::string& name) const;
+	const std::string& GetString(const std::string& name) const;
+
+	void SetBool(const std::string& name, bool value);
+	void SetNumber(const std::string& name, float value);
+	void SetString(const std::string& name, const std::string& value);
+
+	// points a value at a copy of the text kept by this instance, for strings made while running,
+	// dest must be one of this instance's slots or a value from GetNodeValue
+	void SetValueString(ValueData& dest, const std::string& text);
+	void SetValueString(ValueData& dest, const ValueData& value);
+
+	// stores the value as text in a compile time bound string global, literals are shared rather than copied
+	void SetStringGlobal(uint32_t index, const ValueData& value, bool literal = false);
+
+	// globals whose names were bound at compile time, indexed by the program's global symbols
+	std::vector<uint8_t> BoolGlobalSlots;
+	std::vector<float> NumGlobalSlots;
+	std::vector<const std::string*> StringGlobalSlots;
+
+	// globals with names that are only known at run time
 	std::unordered_map<std::string, bool> BoolGlobals;
 	std::unordered_map<std::string, float> NumGlobals;
 	std::unordered_map<std::string, std::string> StringGlobals;
 	std::unordered_map<uint32_t, int> NodeStateNums;
 
-	std::stack<uint32_t> ReturnStack;
+	// value registers for the compiled program
+	std::vector<ValueData> Slots;
+
+	// the counter of each loop in the compiled program, -1 until its first cycle
+	std::vector<int32_t> LoopFrames;
+
+	// instruction indexes to resume from when a flow chain ends, reuses its storage from cycle to cycle
+	std::vector<uint32_t> ReturnStack;
 	uint32_t CurrentNode = 0;
+	uint32_t ProgramCounter = uint32_t(-1);
+
+	// the entry point of the current or last run
+	ScriptGraph::EntryHandle EntryPoint = ScriptGraph::InvalidEntry;
 
 	bool Running = false;
 
+	// Run uses ahead of time compiled entry points when the program has them
+	bool UsePrecompiled = true;
+
+	// Run uses JIT compiled entry points when the graph was compiled with UseJit
+	bool UseJit = true;
+
+	// Run and Start clear every global first, turn off to keep state such as per agent data between runs
+	bool ResetGlobals = true;
+
+	// instrumentation policies, see script_instrumentation.h, while one is set every run goes through the interpreter
+
+	// records per node timings, see script_profiler.h
+	ScriptProfiler* Profiler = nullptr;
+
+	// counts instructions, value reads and global writes
+	ScriptCounters* Counters = nullptr;
+
+	// stops in front of breakpoints, takes priority over the others
+	ScriptDebugger* Debugger = nullptr;
+
+	// takes a sample of where the script is now and then, see script_sampler.h
+	ScriptSampler* Sampler = nullptr;
+
+	inline bool IsInstrumented() const
+	{
+#if defined(SCRIPT_GRAPH_NO_INSTRUMENTATION)
+		return false;
+#else
+		return Profiler || Counters || Debugger || Sampler;
+#endif
+	}
+
+	inline const std::shared_ptr<const ScriptProgram>& GetProgram() const { return Program; }
+	inline const ScriptGraph& GetGraph() const { return Graph; }
+
 protected:
-	ScriptGraph& Graph;
+	friend class ScriptJit;
+	friend class ScriptBatch;
+
+	bool Waiting = false;
+	float WaitSeconds = 0;
+
+	const ScriptGraph& Graph;
+	std::shared_ptr<const ScriptProgram> Program;
+
+	// results for nodes the program has no slots for, such as ones added since it was compiled, one per node value
+	std::unordered_map<uint64_t, ValueData> LooseValues;
+
+	// text made while running, per slot, per string global and per loose value, reused from run to run
+	// string globals keep theirs in a deque so growing it for a new program leaves the text where it is
+	std::vector<std::string> SlotStrings;
+	std::deque<std::string> GlobalStrings;
+	std::unordered_map<const ValueData*, std::string> LooseStrings;
 	Result RunResult = Result::Error;
 
+	struct ValueCacheEntry
+	{
+		uint32_t StepEpoch = 0;
+		uint32_t GlobalEpoch = 0;
+		const ValueData* Value = nullptr;
+	};
+
+	// results of GetValue calls on pure nodes, valid while the epochs match
+	std::vector<ValueCacheEntry> ValueCache;
+	uint32_t StepEpoch = 1;
+	uint32_t GlobalEpoch = 1;
+
+	static constexpr uint32_t MaxStepSlice = 4096;
+
 protected:
-	bool RunStep();
+	bool Begin(ScriptGraph::EntryHandle entryPoint);
+	std::string& GetValueStorage(const ValueData& dest);
+	std::shared_ptr<const SnapshotStrings> CaptureStrings() const;
+	void RestoreStrings(const SnapshotStrings* strings);
+	uint32_t Execute(uint32_t maxInstructions);
+	template<class Policy> uint32_t ExecuteProgram(Policy& policy, uint32_t maxInstructions);
+	template<class Policy> void ReadValues(Policy& policy, uint32_t begin, uint32_t end);
+	Result FinishStep();
+	void EvaluateValues(uint32_t begin, uint32_t end);
+	void NextStep();
 	void Clear();
 };
 
@@ -290,7 +549,7 @@ public:
 	DEFINE_NODE(EntryNode);
 
 	EntryNode();
-	const NodeRef* Process(ScriptInstance& state) override;
+	const NodeRef* Process(ScriptInstance& state) const override;
 };
 
 class Condition : public Node
@@ -299,7 +558,16 @@ public:
 	DEFINE_NODE(Condition);
 
 	Condition();
-	const NodeRef* Process(ScriptInstance& state) override;
+	const NodeRef* Process(ScriptInstance& state) const override;
+};
+
+class Delay : public Node
+{
+public:
+	DEFINE_NODE(Delay);
+
+	Delay();
+	const NodeRef* Process(ScriptInstance& state) const override;
 };
 
 class Loop : public Node 
@@ -308,17 +576,15 @@ public:
 	DEFINE_NODE(Loop);
 
 	Loop();
-	const NodeRef* Process(ScriptInstance& state) override;
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
+	const NodeRef* Process(ScriptInstance& state) const override;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool ValuesUseArguments() const override { return false; }
 
 	uint32_t Itterations = 0;
 
 	void Read(void* data, size_t size, size_t& offset) override;
 	size_t GetDataSize() override;
 	bool Write(void* data, size_t& offset) override;
-
-protected:
-	NumberValueData IndexValue;
 };
 
 template<class T>
@@ -355,29 +621,32 @@ public:
 		}
 	}
 
+	static inline bool Evaluate(Operation op, bool a, bool b)
+	{
+		if (op == Operation::AND)
+			return a && b;
+		return a || b;
+	}
+
 	BooleanComparison(Operation op = Operation::AND);
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool IsPure() const override { return true; }
 
 	DEFINE_NODE(BooleanComparison);
 
 	void Read(void* data, size_t size, size_t& offset) override;
 	size_t GetDataSize() override;
 	bool Write(void* data, size_t& offset) override;
-
-protected:
-	BooleanValueData ReturnValue;
 };
 
 class NotComparison : public Node
 {
 public:
 	NotComparison();
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool IsPure() const override { return true; }
 
 	DEFINE_NODE(NotComparison);
-
-protected:
-	BooleanValueData ReturnValue;
 };
 
 class NumberComparison : public Node
@@ -416,17 +685,36 @@ public:
 		}
 	}
 
+	static inline bool Evaluate(Operation op, float a, float b)
+	{
+		switch (op)
+		{
+			case Operation::GreaterThan:
+				return a > b;
+			case Operation::GreaterThanEqual:
+				return a >= b;
+			case Operation::LessThan:
+				return a < b;
+			case Operation::LessThanEqual:
+				return a <= b;
+			case Operation::Equal:
+				return a == b;
+			case Operation::NotEqual:
+				return a != b;
+			default:
+				return false;
+		}
+	}
+
 	NumberComparison(Operation op = Operation::GreaterThan);
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool IsPure() const override { return true; }
 
 	void Read(void* data, size_t size, size_t& offset) override;
 	size_t GetDataSize() override;
 	bool Write(void* data, size_t& offset) override;
 
 	DEFINE_NODE(NumberComparison);
-
-protected:
-	BooleanValueData ReturnValue;
 };
 
 // Math
@@ -466,17 +754,36 @@ public:
 		}
 	}
 
+	static inline float Evaluate(Operation op, float a, float b)
+	{
+		switch (op)
+		{
+			case Operation::Add:
+				return a + b;
+			case Operation::Subtract:
+				return a - b;
+			case Operation::Multiply:
+				return a * b;
+			case Operation::Divide:
+				return a / b;
+			case Operation::Modulo:
+				return int(b) != 0 ? float(int(a) % int(b)) : 0.0f;
+			case Operation::Pow:
+				return powf(a, b);
+			default:
+				return 0;
+		}
+	}
+
 	DEFINE_NODE(Math);
 
 	Math(Operation op = Operation::Add);
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool IsPure() const override { return true; }
 
 	void Read(void* data, size_t size, size_t& offset) override;
 	size_t GetDataSize() override;
 	bool Write(void* data, size_t& offset) override;
-
-protected:
-	NumberValueData ReturnValue;
 };
 
 // Literals
@@ -485,17 +792,18 @@ class BooleanLiteral : public Node
 public:
 	DEFINE_NODE(BooleanLiteral);
 	BooleanLiteral(bool value = false);
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool IsPure() const override { return true; }
 
-	inline void SetValue(const bool& value) { ReturnValue.Value = value; };
-	inline bool GetValue() const { return ReturnValue.Value; };
+	inline void SetValue(const bool& value) { ReturnValue.SetBool(value); };
+	inline bool GetValue() const { return ReturnValue.BoolValue; };
 
 	void Read(void* data, size_t size, size_t& offset) override;
 	size_t GetDataSize() override;
 	bool Write(void* data, size_t& offset) override;
 
 protected:
-	BooleanValueData ReturnValue;
+	ValueData ReturnValue;
 };
 
 class NumberLiteral : public Node
@@ -504,27 +812,29 @@ public:
 	DEFINE_NODE(NumberLiteral);
 
 	NumberLiteral(float value = 0);
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool IsPure() const override { return true; }
 
-	inline void SetValue(const float& value) { ReturnValue.Value = value; };
-	inline float GetValue() const { return ReturnValue.Value; };
+	inline void SetValue(const float& value) { ReturnValue.SetNumber(value); };
+	inline float GetValue() const { return ReturnValue.NumberValue; };
 
 	void Read(void* data, size_t size, size_t& offset) override;
 	size_t GetDataSize() override;
 	bool Write(void* data, size_t& offset) override;
 
 protected:
-	NumberValueData ReturnValue;
+	ValueData ReturnValue;
 };
 
 class StringLiteral : public Node
 {
 public:
 	StringLiteral(const std::string& value = "");
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool IsPure() const override { return true; }
 
-	inline void SetValue(const std::string& text) { ReturnValue.Value = text; };
-	inline const char* GetValue() const { return ReturnValue.Value.c_str(); };
+	inline void SetValue(const std::string& text) { ReturnValue.SetString(text); };
+	inline const char* GetValue() const { return ReturnValue.StringValue->c_str(); };
 
 	DEFINE_NODE(StringLiteral);
 
@@ -533,7 +843,7 @@ public:
 	bool Write(void* data, size_t& offset) override;
 
 protected:
-	StringValueData ReturnValue;
+	ValueData ReturnValue;
 };
 
 // Debug
@@ -543,7 +853,7 @@ public:
 	DEFINE_NODE(PrintLog);
 
 	PrintLog();
-	const NodeRef* PrintLog::Process(ScriptInstance& state) override;
+	const NodeRef* Process(ScriptInstance& state) const override;
 
 	static std::function<void(const std::string&)> LogFunction;
 };
@@ -555,10 +865,8 @@ public:
 	DEFINE_NODE(LoadBool);
 
 	LoadBool();
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
-
-protected:
-	BooleanValueData ReturnValue;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool ReadsGlobals() const override { return true; }
 };
 
 class SaveBool : public Node
@@ -567,7 +875,7 @@ public:
 	DEFINE_NODE(SaveBool);
 
 	SaveBool();
-	const NodeRef* Process(ScriptInstance& state) override;
+	const NodeRef* Process(ScriptInstance& state) const override;
 };
 
 class LoadNumber : public Node
@@ -576,10 +884,8 @@ public:
 	DEFINE_NODE(LoadNumber);
 
 	LoadNumber();
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
-
-protected:
-	NumberValueData ReturnValue;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool ReadsGlobals() const override { return true; }
 };
 
 class SaveNumber : public Node
@@ -588,7 +894,7 @@ public:
 	DEFINE_NODE(SaveNumber);
 
 	SaveNumber();
-	const NodeRef* Process(ScriptInstance& state) override;
+	const NodeRef* Process(ScriptInstance& state) const override;
 };
 
 class LoadString : public Node
@@ -597,10 +903,8 @@ public:
 	DEFINE_NODE(LoadString);
 
 	LoadString();
-	const ValueData* GetValue(uint32_t id, ScriptInstance& state) override;
-
-protected:
-	StringValueData ReturnValue;
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override;
+	bool ReadsGlobals() const override { return true; }
 };
 
 class SaveString : public Node
@@ -609,7 +913,7 @@ public:
 	DEFINE_NODE(SaveString);
 
 	SaveString();
-	const NodeRef* Process(ScriptInstance& state) override;
+	const NodeRef* Process(ScriptInstance& state) const override;
 };
 
 
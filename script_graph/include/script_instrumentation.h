@@ -0,0 +1,91 @@
+#pragma once
+
+#include "script_program.h"
+
+#include <unordered_set>
+
+// the interpreter loop is a template over one of these, the hooks are plain inline calls so a policy that does
+// nothing compiles down to the same loop as no policy at all
+//
+// every policy has
+//	bool EnterNode(ScriptInstance& instance, uint32_t pc)		before a node runs, false stops in front of it
+//	void ExitNode(ScriptInstance& instance, uint32_t pc)		after it ran, before the return stack is popped,
+//	void WriteGlobal(ScriptInstance& instance, uint32_t pc)		after a node changed any global, both only when ExitHooks is set
+//	void EnterValue(ScriptInstance& instance, const ValueOp& op)	around each value the node reads,
+//	void ExitValue(ScriptInstance& instance, const ValueOp& op)	only called when ValueHooks is set
+//
+// define SCRIPT_GRAPH_NO_INSTRUMENTATION to leave only the empty policy in the build
+
+struct NoInstrumentation
+{
+	static constexpr bool ExitHooks = false;
+	static constexpr bool ValueHooks = false;
+
+	inline bool EnterNode(ScriptInstance&, uint32_t) { return true; }
+	inline void ExitNode(ScriptInstance&, uint32_t) {}
+	inline void EnterValue(ScriptInstance&, const ValueOp&) {}
+	inline void ExitValue(ScriptInstance&, const ValueOp&) {}
+	inline void WriteGlobal(ScriptInstance&, uint32_t) {}
+};
+
+// how often each instruction and value ran, cheap enough to leave on in test builds
+class ScriptCounters
+{
+public:
+	static constexpr bool ExitHooks = true;
+	static constexpr bool ValueHooks = true;
+
+	// per instruction index of the program that ran
+	std::vector<uint64_t> Instructions;
+	uint64_t ValueReads = 0;
+	uint64_t GlobalWrites = 0;
+
+	void Reset();
+
+	// one line per node that ran, busiest first
+	std::string GetReport(const ScriptProgram& program) const;
+
+	inline bool EnterNode(ScriptInstance&, uint32_t pc)
+	{
+		if (pc >= Instructions.size())
+			Instructions.resize(size_t(pc) + 1, 0);
+
+		Instructions[pc]++;
+		return true;
+	}
+
+	inline void ExitNode(ScriptInstance&, uint32_t) {}
+	inline void EnterValue(ScriptInstance&, const ValueOp&) {}
+	inline void ExitValue(ScriptInstance&, const ValueOp&) { ValueReads++; }
+	inline void WriteGlobal(ScriptInstance&, uint32_t) { GlobalWrites++; }
+};
+
+// stops an instance in front of chosen nodes, the instance stays running and carries on from there on its next step
+class ScriptDebugger
+{
+public:
+	static constexpr bool ExitHooks = true;
+	static constexpr bool ValueHooks = false;
+
+	// node IDs to stop at
+	std::unordered_set<uint32_t> Breakpoints;
+
+	// stop in front of every node
+	bool SingleStep = false;
+
+	// the node the instance is stopped at, -1 while it is not stopped
+	uint32_t BreakNode = uint32_t(-1);
+
+	std::function<void(ScriptInstance& instance, uint32_t nodeId)> OnBreak;
+	std::function<void(ScriptInstance& instance, uint32_t nodeId)> OnGlobalWrite;
+
+	bool EnterNode(ScriptInstance& instance, uint32_t pc);
+	inline void ExitNode(ScriptInstance&, uint32_t) {}
+	inline void EnterValue(ScriptInstance&, const ValueOp&) {}
+	inline void ExitValue(ScriptInstance&, const ValueOp&) {}
+	void WriteGlobal(ScriptInstance& instance, uint32_t pc);
+
+protected:
+	// the instruction the instance last stopped at, it runs the next time it is reached
+	uint32_t ResumePc = uint32_t(-1);
+};
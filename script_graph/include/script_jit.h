@@ -0,0 +1,127 @@
+#pragma once
+
+#include "script_program.h"
+
+#include <map>
+
+// the template JIT only knows how to write x86-64 code for the System V calling convention
+#if defined(__linux__) && defined(__x86_64__) && !defined(SCRIPT_GRAPH_NO_JIT)
+#define SCRIPT_GRAPH_JIT 1
+#endif
+
+// stitches machine code templates for each instruction of an entry point into executable memory
+// numbers and bools with known types are handled inline, everything else calls back into the interpreter's helpers
+class ScriptJit
+{
+public:
+	using EntryFunction = void(*)(ScriptInstance* instance, ValueData* slots, uint8_t* boolGlobals, float* numberGlobals, const std::string** stringGlobals);
+
+	ScriptJit() = default;
+	ScriptJit(const ScriptJit&) = delete;
+	ScriptJit& operator=(const ScriptJit&) = delete;
+	~ScriptJit();
+
+	static bool IsAvailable();
+
+	// writes every entry point it can handle, false if none could be
+	bool Compile(const ScriptProgram& program);
+
+	inline EntryFunction GetEntry(uint32_t handle) const
+	{
+		return handle < Entries.size() ? Entries[handle] : nullptr;
+	}
+
+	inline size_t GetCodeSize() const { return CodeSize; }
+
+	// entries that can only run in the interpreter, with the reason
+	std::vector<std::string> Skipped;
+
+	// lets perf attribute samples in generated code to script nodes
+	static bool WritePerfMap;
+
+protected:
+	std::vector<EntryFunction> Entries;
+
+	void* CodeMemory = nullptr;
+	size_t CodeSize = 0;
+	size_t MappedSize = 0;
+
+	// the loops whose cycle output led here, a chain that ends goes back to the innermost one
+	struct Context
+	{
+		uint32_t LoopPc = ScriptProgram::InvalidTarget;
+		uint32_t Parent = uint32_t(-1);
+		uint32_t Depth = 0;
+	};
+
+	struct Block
+	{
+		uint32_t Pc = 0;
+		uint32_t Context = 0;
+		size_t Offset = 0;
+	};
+
+	struct Fixup
+	{
+		size_t Offset = 0;
+		uint32_t Block = 0;
+	};
+
+	// a named range of code for the perf map
+	struct Symbol
+	{
+		size_t Offset = 0;
+		size_t Size = 0;
+		std::string Name;
+	};
+
+	static constexpr uint32_t MaxLoopDepth = 16;
+	static constexpr uint32_t ReturnBlock = uint32_t(-1);
+
+	const ScriptProgram* Program = nullptr;
+
+	std::vector<uint8_t> Code;
+	std::vector<Symbol> Symbols;
+
+	std::vector<Context> Contexts;
+	std::vector<Block> Blocks;
+	std::map<std::pair<uint32_t, uint32_t>, uint32_t> BlockIndexes;
+	std::vector<Fixup> Fixups;
+	std::vector<size_t> ReturnFixups;
+	std::map<uint32_t, uint32_t> LoopStates;
+	std::string Error;
+
+	// slots with a single known type get inline templates, the rest go through the helpers
+	bool IsSlot(uint32_t slot, ValueTypes type) const;
+
+	bool EmitEntry(uint32_t entryPc, const std::string& name);
+	bool EmitBlock(uint32_t blockIndex, const std::string& name);
+	bool EmitValues(uint32_t begin, uint32_t end);
+	bool EmitValue(uint32_t index);
+
+	uint32_t Target(uint32_t pc, uint32_t context);
+	uint32_t EnterLoop(uint32_t loopPc, uint32_t context);
+	uint32_t LoopState(uint32_t nodeId);
+
+	// templates
+	void Byte(uint8_t value);
+	void Bytes(std::initializer_list<uint8_t> values);
+	void UInt(uint32_t value);
+	void UInt64(uint64_t value);
+	void Rex(bool wide, uint32_t reg, uint32_t base);
+	void Memory(uint32_t reg, uint32_t base, int32_t disp);
+	void Op(std::initializer_list<uint8_t> prefix, std::initializer_list<uint8_t> opcode, bool wide, uint32_t reg, uint32_t base, int32_t disp);
+	void JumpTo(uint32_t block);
+	void JumpIf(uint8_t condition, uint32_t block);
+	void Call(const void* function);
+	void LoadBoolean(uint32_t slot);
+	void StoreTag(uint32_t slot, ValueTypes type);
+
+	int32_t SlotValue(uint32_t slot) const;
+	int32_t SlotTag(uint32_t slot) const;
+
+	// what the generated code calls when it has no inline template
+	static void CallValue(ScriptInstance* instance, uint32_t index);
+	static void CallInstruction(ScriptInstance* instance, uint32_t pc);
+	static bool CallBoolean(const ValueData* value);
+};
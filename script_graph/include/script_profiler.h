@@ -0,0 +1,96 @@
+#pragma once
+
+#include "script_program.h"
+
+#include <map>
+
+// records where an instance spends its time, node by node
+// attach one to ScriptInstance::Profiler to turn it on, while attached Run always uses the interpreter
+// times are kept in raw clock ticks (the TSC where there is one) and only turned into microseconds when exported
+// superinstructions other than a loop with a fused print are timed as their first node, compile with UseFusion off
+// to see every node on its own
+class ScriptProfiler
+{
+public:
+	struct NodeStats
+	{
+		uint64_t Count = 0;
+
+		// time in the node and everything it led to, for loops that includes every cycle of the body
+		uint64_t InclusiveTicks = 0;
+
+		// time in the node itself, without the value nodes it read
+		uint64_t ExclusiveTicks = 0;
+
+		// values the node read, each of its compiled arguments every time it runs, the value nodes worked out for
+		// them and GetValue calls from native nodes
+		uint64_t ValueReads = 0;
+	};
+
+	// one timed node for the trace, depth is how many loops and readers it sits inside
+	struct TraceEvent
+	{
+		uint32_t NodeId = 0;
+		uint32_t Depth = 0;
+		uint64_t Start = 0;
+		uint64_t Ticks = 0;
+	};
+
+	ScriptProfiler();
+
+	// drops everything recorded so far
+	void Reset();
+
+	// keyed by node ID
+	std::map<uint32_t, NodeStats> Nodes;
+
+	// exclusive ticks per call path of node IDs, the entry point first, then the loops, then the node
+	std::map<std::vector<uint32_t>, uint64_t> Stacks;
+
+	// the trace stops growing once it is full, the stats keep going
+	std::vector<TraceEvent> Events;
+	size_t MaxEvents = 1 << 20;
+
+	// one line per node, most expensive first
+	std::string GetReport(const ScriptGraph& graph) const;
+
+	// folded stacks, one path per line with its microseconds, for flamegraph.pl and speedscope
+	std::string GetFlamegraph(const ScriptGraph& graph) const;
+
+	// trace_event JSON for chrome://tracing and Perfetto
+	std::string GetChromeTrace(const ScriptGraph& graph) const;
+
+	double GetTicksPerMicrosecond() const;
+
+	static uint64_t Now();
+
+	// the tracing instrumentation policy, see script_instrumentation.h
+	static constexpr bool ExitHooks = true;
+	static constexpr bool ValueHooks = true;
+
+	bool EnterNode(ScriptInstance& instance, uint32_t pc);
+	void ExitNode(ScriptInstance& instance, uint32_t pc);
+	inline void EnterValue(ScriptInstance&, const ValueOp&) { ValueStart = Now(); }
+	inline void ExitValue(ScriptInstance&, const ValueOp& op) { ReadValue(op.NodeId, ValueStart, Now()); }
+	inline void WriteGlobal(ScriptInstance&, uint32_t) {}
+
+	// called by the instance for things outside the interpreter loop
+	void BeginRun(uint32_t entryNodeId);
+	void CountRead(uint32_t nodeId);
+
+protected:
+	// the entry point of the current run and the path to the node being run
+	uint32_t Root = uint32_t(-1);
+	std::vector<uint32_t> Path;
+	uint64_t Start = 0;
+	uint64_t ValueStart = 0;
+	uint64_t ValueTicks = 0;
+
+	// for turning ticks into time
+	uint64_t StartTicks = 0;
+	std::chrono::steady_clock::time_point StartTime;
+
+	void ReadValue(uint32_t valueNodeId, uint64_t start, uint64_t end);
+	std::string GetLabel(const ScriptGraph& graph, uint32_t nodeId) const;
+	void AddEvent(uint32_t nodeId, uint32_t depth, uint64_t start, uint64_t ticks);
+};
@@ -0,0 +1,276 @@
+#pragma once
+
+#include "script_graph.h"
+
+class ScriptJit;
+
+// the flow nodes the interpreter knows how to run directly, anything else is dispatched through Node::Process
+enum class OpCode : uint8_t
+{
+	Entry = 0,
+	Condition,
+	Loop,
+	PrintLog,
+	SaveBool,
+	SaveNumber,
+	SaveString,
+	SaveBoolGlobal,
+	SaveNumberGlobal,
+	SaveStringGlobal,
+	Jump,
+	Delay,
+
+	// superinstructions, each one does a common chain of nodes in a single dispatch
+	CompareBranch,			// NumberComparison into Condition
+	NumberGlobalUpdate,		// LoadNumber into Math into SaveNumber, with both names bound to globals
+	LoopPrint,				// Loop whose body is a single PrintLog
+
+	Native,
+};
+
+// the value nodes the compiler can flatten into register programs
+enum class ValueOpCode : uint8_t
+{
+	Math = 0,
+	NumberComparison,
+	BooleanComparison,
+	Not,
+	LoadBool,
+	LoadNumber,
+	LoadString,
+	LoadBoolGlobal,
+	LoadNumberGlobal,
+	LoadStringGlobal,
+	LoopIndex,
+
+	// coerces A to the type in Operator, only emitted where the inferred type of a pin differs from what reads it
+	Convert,
+
+	Native,
+};
+
+// one step of a postfix value program, reads slots A and B and writes slot Dest
+struct ValueOp
+{
+	ValueOpCode Op = ValueOpCode::Native;
+	uint8_t Operator = 0;
+	uint32_t Dest = uint32_t(-1);
+	uint32_t A = uint32_t(-1);
+	uint32_t B = uint32_t(-1);
+
+	// native value nodes and loop indexes still need to know where they came from
+	uint32_t NodeId = uint32_t(-1);
+	uint32_t ValueId = 0;
+	Node* Source = nullptr;
+};
+
+struct Instruction
+{
+	OpCode Op = OpCode::Native;
+	uint32_t NodeId = uint32_t(-1);
+
+	// instruction indexes for the first two outputs, resolved at compile time
+	uint32_t Next[2] = { uint32_t(-1), uint32_t(-1) };
+
+	// op specific data (loop itterations, global index)
+	uint32_t Operand = 0;
+
+	// loops, which of the instance's loop frames holds their counter
+	uint32_t Frame = uint32_t(-1);
+
+	// superinstructions, the first value op they handle themselves, or for LoopPrint the print instruction
+	uint32_t Fused = uint32_t(-1);
+
+	// the value ops that compute this instruction's arguments and the slots they end up in
+	uint32_t ValueBegin = 0;
+	uint32_t ValueEnd = 0;
+	uint32_t Args[2] = { uint32_t(-1), uint32_t(-1) };
+
+	Node* Source = nullptr;
+};
+
+// a chain of nodes the compiler turned into one superinstruction
+struct FusionInfo
+{
+	const char* Pattern = nullptr;
+	uint32_t NodeId = uint32_t(-1);
+};
+
+// a value the compiler had to change the type of before something could read it
+struct TypeConversion
+{
+	uint32_t NodeId = uint32_t(-1);
+	uint32_t ValueId = 0;
+
+	// dynamic values come from native nodes and can hold anything, From is only the type their slot starts as
+	ValueTypes From = ValueTypes::Number;
+	ValueTypes To = ValueTypes::Number;
+	bool Dynamic = false;
+
+	// done once at compile time because the value is a constant
+	bool Folded = false;
+};
+
+// where a node's memoizable values live in the instance's value cache
+struct ValueCacheInfo
+{
+	uint32_t Index = uint32_t(-1);
+	uint32_t Count = 0;
+	bool DependsOnGlobals = false;
+};
+
+// global names that were known at compile time, bound to an index in the instance's typed global arrays
+struct GlobalSymbols
+{
+	std::unordered_map<std::string, uint32_t> Bools;
+	std::unordered_map<std::string, uint32_t> Numbers;
+	std::unordered_map<std::string, uint32_t> Strings;
+
+	static uint32_t Find(const std::unordered_map<std::string, uint32_t>& table, const std::string& name)
+	{
+		auto itr = table.find(name);
+		if (itr == table.end())
+			return uint32_t(-1);
+
+		return itr->second;
+	}
+};
+
+// a script graph lowered into a linear instruction array
+class ScriptProgram
+{
+public:
+	static constexpr uint32_t InvalidTarget = uint32_t(-1);
+	static constexpr uint32_t InvalidSlot = uint32_t(-1);
+
+	std::vector<Instruction> Code;
+
+	std::vector<ValueOp> ValueCode;
+
+	// initial register contents, literals are written once here and never touched again
+	std::vector<ValueData> Slots;
+
+	// per node index, the first slot of that node's values, with one extra entry to end the last node
+	std::vector<uint32_t> NodeSlots;
+
+	// per node index, the loop frame of each loop node
+	std::vector<uint32_t> NodeLoopFrames;
+	uint32_t LoopFrameCount = 0;
+
+	// entry point names to handles, and handles to instruction indexes
+	std::map<std::string, uint32_t> EntryPoints;
+	std::vector<uint32_t> EntryTable;
+
+	// ahead of time compiled versions of the entry points, null when there are none
+	std::vector<NodeRegistry::PrecompiledEntry> PrecompiledEntries;
+
+	// machine code for the entry points, only built when the graph asks for it and the platform supports it
+	std::shared_ptr<ScriptJit> Jit;
+
+	// identifies the exact instruction stream, precompiled entries are only used when it matches
+	uint64_t Hash = 0;
+
+	// the graph passed Verify when this was compiled, so node refs can be followed by index alone
+	bool Unchecked = false;
+
+	// slots that can change type while running, anything a native node or a conflicting load writes to,
+	// every other slot always holds the type it was created with
+	std::vector<bool> DynamicSlots;
+
+	// node index to instruction index, only needed by native nodes that return arbitrary refs
+	std::vector<uint32_t> NodeInstructions;
+
+	GlobalSymbols Globals;
+
+	// the superinstructions the compiler made, for reporting
+	std::vector<FusionInfo> Fusions;
+
+	// every place a value had to change type, everything else is read without coercion
+	std::vector<TypeConversion> Conversions;
+
+	// per node index, the values that ScriptInstance::GetValue may serve from its cache
+	std::vector<ValueCacheInfo> CachedValues;
+	uint32_t CacheSize = 0;
+
+	bool Compile(const ScriptGraph& graph);
+
+	// one line per fusion pattern with how often it fired and on which nodes
+	std::string GetFusionReport() const;
+
+	// one line per conversion, runtime ones are the ones worth fixing in the graph
+	std::string GetTypeReport() const;
+
+	// the plain instruction a superinstruction stands in for, for backends that do their own thing with chains
+	static Instruction Unfuse(const Instruction& ins);
+
+	uint32_t FindEntryPoint(const std::string& name) const;
+	uint32_t FindEntryHandle(const std::string& name) const;
+
+	inline NodeRegistry::PrecompiledEntry GetPrecompiledEntry(uint32_t handle) const
+	{
+		return handle < PrecompiledEntries.size() ? PrecompiledEntries[handle] : nullptr;
+	}
+
+	inline bool HasFixedType(uint32_t slot) const
+	{
+		return slot < DynamicSlots.size() && !DynamicSlots[slot];
+	}
+
+	// literals and folded literals, a string one points at interned text that outlives every instance
+	inline bool IsConstant(uint32_t slot) const
+	{
+		return slot < ConstantSlots.size() && ConstantSlots[slot];
+	}
+
+	inline uint32_t GetEntryPoint(uint32_t handle) const
+	{
+		return handle < EntryTable.size() ? EntryTable[handle] : InvalidTarget;
+	}
+	inline uint32_t FindInstruction(uint32_t nodeIndex) const
+	{
+		return nodeIndex < NodeInstructions.size() ? NodeInstructions[nodeIndex] : InvalidTarget;
+	}
+
+	inline uint32_t FindLoopFrame(uint32_t nodeIndex) const
+	{
+		return nodeIndex < NodeLoopFrames.size() ? NodeLoopFrames[nodeIndex] : InvalidSlot;
+	}
+
+	inline uint32_t FindNodeSlot(uint32_t nodeIndex, uint32_t valueId) const
+	{
+		if (nodeIndex + 1 >= NodeSlots.size() || valueId >= NodeSlots[nodeIndex + 1] - NodeSlots[nodeIndex])
+			return InvalidSlot;
+
+		return NodeSlots[nodeIndex] + valueId;
+	}
+
+	inline const ValueCacheInfo* FindCachedValue(uint32_t nodeIndex) const
+	{
+		if (nodeIndex >= CachedValues.size() || CachedValues[nodeIndex].Count == 0)
+			return nullptr;
+
+		return &CachedValues[nodeIndex];
+	}
+
+protected:
+	uint32_t CompileValue(const ScriptGraph& graph, const ValueRef& ref);
+	uint32_t CompileArgument(const ScriptGraph& graph, const ValueRef& ref);
+	uint32_t ConvertValue(uint32_t slot, const ValueRef& ref, Node* source);
+	void MarkDynamic(const Node* node);
+	uint32_t GetSlot(uint32_t nodeIndex, uint32_t valueId, ValueTypes type);
+	uint32_t AddSlot(ValueTypes type);
+	bool FoldConstant(const ValueOp& op);
+	uint32_t BindGlobal(std::unordered_map<std::string, uint32_t>& table, uint32_t nameSlot);
+	void BuildValueCache(const ScriptGraph& graph);
+	void FuseInstructions();
+	uint64_t ComputeHash() const;
+
+	std::unordered_map<uint64_t, uint32_t> ValueSlots;
+	std::unordered_map<uint64_t, bool> EmittedValues;
+
+	// source slot and target type to the slot holding the converted value
+	std::unordered_map<uint64_t, uint32_t> ConvertedSlots;
+
+	// slots whose value is known at compile time, literals and folded literal-only subtrees
+	std::vector<bool> ConstantSlots;
+};
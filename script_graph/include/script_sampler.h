@@ -0,0 +1,116 @@
+#pragma once
+
+#include "script_program.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// a statistical profiler that is cheap enough to leave on under real load
+// a background thread ticks at a fixed interval, the first node any thread finishes after a tick records where that
+// thread's script is, so each thread is sampled at most once per tick and nothing reads an instance from outside,
+// only ticks that land while a script is running are recorded
+// attach one to ScriptInstance::Sampler on every instance to watch, one sampler can serve any number of threads
+// and a thread can run under any number of samplers, each keeps its own ticks
+class ScriptSampler
+{
+public:
+	struct EntrySamples
+	{
+		const ScriptGraph* Graph = nullptr;
+		ScriptGraph::EntryHandle EntryPoint = ScriptGraph::InvalidEntry;
+		uint64_t Samples = 0;
+
+		// samples per node ID
+		std::map<uint32_t, uint64_t> Nodes;
+
+		// samples per path of node IDs, the loops the node was running inside then the node
+		std::map<std::vector<uint32_t>, uint64_t> Paths;
+	};
+
+	ScriptSampler() = default;
+	ScriptSampler(const ScriptSampler&) = delete;
+	ScriptSampler& operator=(const ScriptSampler&) = delete;
+	~ScriptSampler();
+
+	void Start(std::chrono::microseconds interval = std::chrono::microseconds(1000));
+	void Stop();
+	void Reset();
+
+	// copies of what was gathered so far, per graph and entry point
+	std::vector<EntrySamples> GetSamples() const;
+
+	// per graph and entry point, the hottest nodes and call paths with their share of the samples
+	// the graphs that were sampled must still be alive
+	std::string GetReport(size_t maxLines = 10) const;
+
+	// folded stacks of sample counts, the graph and entry point at the root
+	std::string GetFlamegraph() const;
+
+	// the instrumentation policy, see script_instrumentation.h
+	static constexpr bool ExitHooks = true;
+	static constexpr bool ValueHooks = false;
+
+	inline bool EnterNode(ScriptInstance&, uint32_t) { return true; }
+
+	// called as a run or step starts running nodes, ticks that passed while this thread ran no script are dropped
+	// rather than charged to whichever node finishes first
+	inline void BeginExecute()
+	{
+		if (LastTick.Sampler != Id)
+			SwitchThreadTick();
+
+		LastTick.Tick = Tick.load(std::memory_order_relaxed);
+	}
+
+	// a tick most likely landed while the node that just finished was running, so that is the one recorded
+	inline void ExitNode(ScriptInstance& instance, uint32_t pc)
+	{
+		uint32_t tick = Tick.load(std::memory_order_relaxed);
+		if (LastTick.Sampler != Id)
+			SwitchThreadTick();
+
+		if (tick != LastTick.Tick)
+		{
+			LastTick.Tick = tick;
+			Record(instance, pc);
+		}
+	}
+
+	inline void EnterValue(ScriptInstance&, const ValueOp&) {}
+	inline void ExitValue(ScriptInstance&, const ValueOp&) {}
+	inline void WriteGlobal(ScriptInstance&, uint32_t) {}
+
+protected:
+	// starts at 0 so threads do not take a sample before the first tick
+	std::atomic<uint32_t> Tick = 0;
+
+	// tells samplers apart in the thread locals, unlike the address it is never reused
+	static inline std::atomic<uint64_t> NextId = 1;
+	const uint64_t Id = NextId.fetch_add(1, std::memory_order_relaxed);
+
+	// the tick this thread last took a sample at, for the sampler it last ran under, starts zeroed, defined here
+	// and kept plain so the interpreter reads it directly instead of through a thread local wrapper call
+	struct ThreadTick
+	{
+		uint64_t Sampler;
+		uint32_t Tick;
+	};
+	static inline thread_local ThreadTick LastTick;
+
+	// the ticks for the other samplers this thread has run under, only touched when the thread changes sampler
+	static inline thread_local std::unordered_map<uint64_t, uint32_t> OtherTicks;
+
+	std::atomic<bool> Running = false;
+	std::thread Thread;
+
+	mutable std::mutex Lock;
+	std::map<std::pair<const ScriptGraph*, ScriptGraph::EntryHandle>, EntrySamples> Entries;
+
+	void Record(ScriptInstance& instance, uint32_t pc);
+	void SwitchThreadTick();
+	void ThreadMain(std::chrono::microseconds interval);
+
+	static std::string GetLabel(const ScriptGraph& graph, uint32_t nodeId);
+	static std::string GetEntryName(const ScriptGraph& graph, ScriptGraph::EntryHandle entryPoint);
+};
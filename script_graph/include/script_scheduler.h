@@ -0,0 +1,100 @@
+#pragma once
+
+#include "script_graph.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+
+// runs batches of script instances across a pool of worker threads
+class ScriptScheduler
+{
+public:
+	struct Job
+	{
+		ScriptInstance* Instance = nullptr;
+
+		// started when the instance is not already running, a running instance picks up where it left off
+		ScriptGraph::EntryHandle EntryPoint = ScriptGraph::InvalidEntry;
+
+		// filled in when the job has run
+		ScriptInstance::Result Status = ScriptInstance::Result::Complete;
+		uint32_t NodesRun = 0;
+	};
+
+	struct FrameStats
+	{
+		uint32_t Jobs = 0;
+		uint32_t Completed = 0;
+		uint32_t Incomplete = 0;
+		uint32_t Waiting = 0;
+		uint32_t Errors = 0;
+		uint32_t Steals = 0;
+		uint64_t NodesRun = 0;
+		double Seconds = 0;
+
+		inline double JobsPerSecond() const { return Seconds > 0 ? Jobs / Seconds : 0; }
+		inline double NodesPerSecond() const { return Seconds > 0 ? NodesRun / Seconds : 0; }
+	};
+
+	// 0 uses one worker per hardware thread, the calling thread always counts as one of them
+	ScriptScheduler(uint32_t workerCount = 0);
+	~ScriptScheduler();
+
+	ScriptScheduler(const ScriptScheduler&) = delete;
+	ScriptScheduler& operator=(const ScriptScheduler&) = delete;
+
+	// runs every job and returns once they are all done, a budget of 0 runs each job to completion
+	const FrameStats& RunFrame(std::vector<Job>& jobs, uint32_t maxNodesPerJob = 0);
+
+	inline const FrameStats& GetLastFrameStats() const { return LastFrame; }
+	inline uint32_t GetWorkerCount() const { return WorkerCount; }
+
+	// how many jobs a worker takes off a range at a time, smaller ranges are left for other workers to steal
+	uint32_t Grain = 32;
+
+protected:
+	struct JobRange
+	{
+		uint32_t Begin = 0;
+		uint32_t End = 0;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex Lock;
+		std::deque<JobRange> Ranges;
+	};
+
+	uint32_t WorkerCount = 1;
+	std::vector<std::unique_ptr<WorkerQueue>> Queues;
+	std::vector<std::thread> Threads;
+
+	std::mutex FrameLock;
+	std::condition_variable FrameStart;
+	std::condition_variable FrameDone;
+	uint64_t FrameId = 0;
+	uint32_t BusyWorkers = 0;
+	bool Quit = false;
+
+	Job* FrameJobs = nullptr;
+	uint32_t FrameBudget = 0;
+	std::atomic<uint32_t> RemainingJobs{ 0 };
+
+	std::atomic<uint32_t> FrameCompleted{ 0 };
+	std::atomic<uint32_t> FrameIncomplete{ 0 };
+	std::atomic<uint32_t> FrameWaiting{ 0 };
+	std::atomic<uint32_t> FrameErrors{ 0 };
+	std::atomic<uint32_t> FrameSteals{ 0 };
+	std::atomic<uint64_t> FrameNodes{ 0 };
+
+	FrameStats LastFrame;
+
+	void WorkerMain(uint32_t worker);
+	void WorkFrame(uint32_t worker);
+	bool PopRange(uint32_t worker, JobRange& range);
+	bool StealRange(uint32_t worker, JobRange& range);
+	void RunJob(Job& job);
+};
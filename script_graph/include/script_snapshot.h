@@ -0,0 +1,62 @@
+#pragma once
+
+#include "script_program.h"
+
+// text an instance made while running, by string global or slot, and the slots reading a string global's text
+struct SnapshotStrings
+{
+	std::vector<std::pair<uint32_t, std::string>> Globals;
+	std::vector<std::pair<uint32_t, std::string>> Slots;
+	std::vector<std::pair<uint32_t, uint32_t>> SlotGlobals;
+};
+
+// the whole state of an instance at one point, taken with ScriptInstance::Snapshot and put back with Restore
+// globals bound at compile time, value slots, loop counters and the return stack are plain data, so they sit in
+// one flat block and a restore is a handful of memcpys, literals are interned and their pointers stay valid,
+// text the instance made while running is kept to one side and pointed back at the restoring instance's own copy
+// a snapshot never changes once taken, copies share the same data, so one taken per frame can be handed to any
+// number of forks or kept in a rollback buffer without copying it again
+class ScriptSnapshot
+{
+public:
+	inline bool IsValid() const { return Data != nullptr; }
+
+	// bytes of flat data, names only known at run time are kept to one side and not counted
+	inline size_t GetSize() const { return Data ? Data->size() : 0; }
+
+	inline const std::shared_ptr<const ScriptProgram>& GetProgram() const { return Program; }
+
+protected:
+	friend class ScriptInstance;
+
+	struct Header
+	{
+		uint32_t Bools = 0;
+		uint32_t Numbers = 0;
+		uint32_t Strings = 0;
+		uint32_t Slots = 0;
+		uint32_t LoopFrames = 0;
+		uint32_t ReturnStack = 0;
+
+		uint32_t CurrentNode = 0;
+		uint32_t ProgramCounter = 0;
+		uint32_t EntryPoint = 0;
+		float WaitSeconds = 0;
+		bool Running = false;
+		bool Waiting = false;
+	};
+
+	// globals and loop counters keyed by name or node, usually empty once a graph is compiled
+	struct DynamicState
+	{
+		std::unordered_map<std::string, bool> BoolGlobals;
+		std::unordered_map<std::string, float> NumGlobals;
+		std::unordered_map<std::string, std::string> StringGlobals;
+		std::unordered_map<uint32_t, int> NodeStateNums;
+	};
+
+	std::shared_ptr<const ScriptProgram> Program;
+	std::shared_ptr<const std::vector<uint8_t>> Data;
+	std::shared_ptr<const DynamicState> Dynamic;
+	std::shared_ptr<const SnapshotStrings> Strings;
+};
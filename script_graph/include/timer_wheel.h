@@ -0,0 +1,63 @@
+#pragma once
+
+#include "script_graph.h"
+
+// hierarchical timing wheel that holds suspended instances until their delay has passed
+// inserting, cancelling and expiring a timer are all O(1), idle instances cost nothing per tick
+class TimerWheel
+{
+public:
+	using TimerId = uint64_t;
+	static constexpr TimerId InvalidTimer = 0;
+
+	TimerWheel(double tickSeconds = 0.001);
+
+	// parks an instance that stopped on a delay node, using the delay it asked for
+	TimerId Park(ScriptInstance& instance);
+	TimerId Schedule(ScriptInstance& instance, double seconds);
+	bool Cancel(TimerId id);
+
+	// moves time forward, resumes every instance whose timer expired and returns them in the order they woke
+	const std::vector<ScriptInstance*>& Advance(double seconds);
+
+	inline size_t GetParkedCount() const { return Parked; }
+	inline uint64_t GetCurrentTick() const { return CurrentTick; }
+	inline double GetTickSeconds() const { return TickSeconds; }
+
+protected:
+	static constexpr uint32_t LevelBits = 8;
+	static constexpr uint32_t SlotsPerLevel = 1 << LevelBits;
+	static constexpr uint32_t SlotMask = SlotsPerLevel - 1;
+	static constexpr uint32_t Levels = 4;
+	static constexpr uint32_t InvalidEntry = uint32_t(-1);
+
+	struct Entry
+	{
+		ScriptInstance* Instance = nullptr;
+		uint64_t Expiry = 0;
+		uint32_t Generation = 1;
+
+		// intrusive list links within a wheel slot
+		uint32_t Prev = InvalidEntry;
+		uint32_t Next = InvalidEntry;
+		uint8_t Level = 0;
+		uint8_t Slot = 0;
+		bool Active = false;
+	};
+
+	double TickSeconds = 0.001;
+	double PendingTicks = 0;
+	uint64_t CurrentTick = 0;
+	size_t Parked = 0;
+
+	std::vector<Entry> Entries;
+	std::vector<uint32_t> FreeEntries;
+	uint32_t Slots[Levels][SlotsPerLevel];
+
+	std::vector<ScriptInstance*> Woken;
+
+	void Insert(uint32_t index);
+	void Unlink(uint32_t index);
+	void Cascade(uint32_t level);
+	void Tick();
+};
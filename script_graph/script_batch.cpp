@@ -0,0 +1,725 @@
+#include "script_batch.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define SCRIPT_BATCH_SSE 1
+#endif
+
+namespace
+{
+	// every kernel has a scalar form for the odd lanes and for targets without SSE
+#ifdef SCRIPT_BATCH_SSE
+#define BATCH_OP(name, scalar, vector) \
+	struct name \
+	{ \
+		static inline float Scalar(float a, float b) { return scalar; } \
+		static inline __m128 Vector(__m128 a, __m128 b) { return vector; } \
+	};
+#else
+#define BATCH_OP(name, scalar, vector) \
+	struct name \
+	{ \
+		static inline float Scalar(float a, float b) { return scalar; } \
+	};
+#endif
+
+	BATCH_OP(AddOp, a + b, _mm_add_ps(a, b))
+	BATCH_OP(SubtractOp, a - b, _mm_sub_ps(a, b))
+	BATCH_OP(MultiplyOp, a * b, _mm_mul_ps(a, b))
+	BATCH_OP(DivideOp, a / b, _mm_div_ps(a, b))
+
+	// comparisons and bools are stored as 0 or 1, the same values Number() gives for a bool
+	BATCH_OP(GreaterOp, a > b ? 1.0f : 0.0f, _mm_and_ps(_mm_cmpgt_ps(a, b), _mm_set1_ps(1.0f)))
+	BATCH_OP(GreaterEqualOp, a >= b ? 1.0f : 0.0f, _mm_and_ps(_mm_cmpge_ps(a, b), _mm_set1_ps(1.0f)))
+	BATCH_OP(LessOp, a < b ? 1.0f : 0.0f, _mm_and_ps(_mm_cmplt_ps(a, b), _mm_set1_ps(1.0f)))
+	BATCH_OP(LessEqualOp, a <= b ? 1.0f : 0.0f, _mm_and_ps(_mm_cmple_ps(a, b), _mm_set1_ps(1.0f)))
+	BATCH_OP(EqualOp, a == b ? 1.0f : 0.0f, _mm_and_ps(_mm_cmpeq_ps(a, b), _mm_set1_ps(1.0f)))
+	BATCH_OP(NotEqualOp, a != b ? 1.0f : 0.0f, _mm_and_ps(_mm_cmpneq_ps(a, b), _mm_set1_ps(1.0f)))
+
+	BATCH_OP(AndOp, a != 0 && b != 0 ? 1.0f : 0.0f, _mm_and_ps(_mm_and_ps(_mm_cmpneq_ps(a, _mm_setzero_ps()), _mm_cmpneq_ps(b, _mm_setzero_ps())), _mm_set1_ps(1.0f)))
+	BATCH_OP(OrOp, a != 0 || b != 0 ? 1.0f : 0.0f, _mm_and_ps(_mm_or_ps(_mm_cmpneq_ps(a, _mm_setzero_ps()), _mm_cmpneq_ps(b, _mm_setzero_ps())), _mm_set1_ps(1.0f)))
+	BATCH_OP(NotOp, a == 0 ? 1.0f : 0.0f, _mm_and_ps(_mm_cmpeq_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f)))
+
+#undef BATCH_OP
+
+	// dest = op(a, b) for the lanes in the mask, the rest keep their old values
+	template<class T>
+	void RunKernel(float* dest, const float* a, const float* b, const uint32_t* mask, uint32_t begin, uint32_t end)
+	{
+		uint32_t i = begin;
+#ifdef SCRIPT_BATCH_SSE
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 active = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)(mask + i)));
+			__m128 result = T::Vector(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+			_mm_storeu_ps(dest + i, _mm_or_ps(_mm_and_ps(active, result), _mm_andnot_ps(active, _mm_loadu_ps(dest + i))));
+		}
+#endif
+		for (; i < end; i++)
+		{
+			if (mask[i])
+				dest[i] = T::Scalar(a[i], b[i]);
+		}
+	}
+}
+
+ScriptBatch::ScriptBatch(const ScriptGraph& graph)
+	: Graph(graph)
+{
+}
+
+const ScriptBatch::BatchStats& ScriptBatch::Run(ScriptGraph::EntryHandle entryPoint, const std::vector<ScriptInstance*>& instances)
+{
+	Stats = BatchStats();
+	Results.assign(instances.size(), ScriptInstance::Result::Error);
+	Groups.clear();
+
+	const auto& program = Graph.GetCompiledProgram();
+	if (!program)
+		return Stats;
+
+	if (program != Program)
+	{
+		Program = program;
+		Prepare();
+	}
+
+	uint32_t entry = Program->GetEntryPoint(entryPoint);
+	if (entry == ScriptProgram::InvalidTarget)
+		return Stats;
+
+	Instances = &instances;
+	uint32_t laneCount = uint32_t(instances.size());
+	Stride = (laneCount + 3) & ~3u;
+
+	// every lane starts from the program's initial slots
+	Lanes.resize(LaneSlots.size() * size_t(Stride));
+	for (uint32_t slot : LaneSlots)
+	{
+		const ValueData& value = Program->Slots[slot];
+		std::fill_n(Row(slot), Stride, value.Type == ValueTypes::Boolean ? (value.BoolValue ? 1.0f : 0.0f) : value.NumberValue);
+	}
+
+	Group start;
+	start.Pc = entry;
+	start.Mask.assign(Stride, 0);
+	start.LoopFrames.assign(Program->LoopFrameCount, -1);
+	for (uint32_t lane = 0; lane < laneCount; lane++)
+	{
+		ScriptInstance* instance = instances[lane];
+		if (!instance || &instance->Graph != &Graph || instance->Running || !instance->Begin(entryPoint))
+			continue;
+
+		start.Mask[lane] = ~0u;
+	}
+
+	UpdateRange(start);
+	Stats.Lanes = start.Count;
+	if (start.Count > 0)
+		Groups.push_back(std::move(start));
+
+	while (!Groups.empty())
+	{
+		// too many ways apart, the smallest group is not worth keeping in lockstep
+		if (Groups.size() > MaxGroups)
+		{
+			auto smallest = std::min_element(Groups.begin(), Groups.end(), [](const Group& a, const Group& b) { return a.Count < b.Count; });
+			RunScalar(*smallest);
+			Groups.erase(smallest);
+			continue;
+		}
+
+		// the group furthest behind goes first, so lanes that split have a chance to meet again
+		size_t pick = 0;
+		for (size_t i = 1; i < Groups.size(); i++)
+		{
+			if (Groups[i].Pc < Groups[pick].Pc)
+				pick = i;
+		}
+
+		pick = MergeGroups(pick);
+		Group& group = Groups[pick];
+
+		if (group.Pc == ScriptProgram::InvalidTarget)
+		{
+			Finish(group);
+			Groups.erase(Groups.begin() + pick);
+			continue;
+		}
+
+		if (!Batchable[group.Pc] || group.Count < MinGroupLanes)
+		{
+			RunScalar(group);
+			Groups.erase(Groups.begin() + pick);
+			continue;
+		}
+
+		Step(pick);
+	}
+
+	Instances = nullptr;
+	return Stats;
+}
+
+void ScriptBatch::Prepare()
+{
+	size_t slotCount = Program->Slots.size();
+
+	std::vector<bool> written(slotCount, false);
+	for (const ValueOp& op : Program->ValueCode)
+	{
+		if (op.Dest < slotCount)
+			written[op.Dest] = true;
+	}
+
+	SlotKinds.assign(slotCount, SlotKind::None);
+	LaneRows.assign(slotCount, uint32_t(-1));
+	LaneSlots.clear();
+
+	// numbers and bools get a row of lanes, strings are only usable when they never change
+	for (uint32_t slot = 0; slot < uint32_t(slotCount); slot++)
+	{
+		if (!Program->HasFixedType(slot))
+			continue;
+
+		if (Program->Slots[slot].Type == ValueTypes::String)
+		{
+			if (!written[slot])
+				SlotKinds[slot] = SlotKind::String;
+			continue;
+		}
+
+		SlotKinds[slot] = SlotKind::Lane;
+		LaneRows[slot] = uint32_t(LaneSlots.size());
+		LaneSlots.push_back(slot);
+	}
+
+	Batchable.assign(Program->Code.size(), false);
+	for (size_t pc = 0; pc < Program->Code.size(); pc++)
+		Batchable[pc] = CanBatch(ScriptProgram::Unfuse(Program->Code[pc]));
+}
+
+bool ScriptBatch::CanBatch(const Instruction& ins) const
+{
+	for (uint32_t i = ins.ValueBegin; i < ins.ValueEnd; i++)
+	{
+		if (!CanBatch(Program->ValueCode[i]))
+			return false;
+	}
+
+	bool hasArg0 = ins.Args[0] != ScriptProgram::InvalidSlot;
+	bool hasArg1 = ins.Args[1] != ScriptProgram::InvalidSlot;
+
+	switch (ins.Op)
+	{
+		case OpCode::Entry:
+		case OpCode::Jump:
+			return true;
+
+		case OpCode::Condition:
+		case OpCode::Loop:
+			return !hasArg0 || IsLane(ins.Args[0]);
+
+		case OpCode::PrintLog:
+			return !hasArg0 || IsLane(ins.Args[0]) || IsString(ins.Args[0]);
+
+		case OpCode::SaveBool:
+		case OpCode::SaveNumber:
+		case OpCode::SaveString:
+			return !hasArg0 || !hasArg1 || (IsString(ins.Args[0]) && (IsLane(ins.Args[1]) || IsString(ins.Args[1])));
+
+		case OpCode::SaveBoolGlobal:
+		case OpCode::SaveNumberGlobal:
+		case OpCode::SaveStringGlobal:
+			return !hasArg1 || IsLane(ins.Args[1]) || IsString(ins.Args[1]);
+
+		default:
+			return false;
+	}
+}
+
+bool ScriptBatch::CanBatch(const ValueOp& op) const
+{
+	switch (op.Op)
+	{
+		case ValueOpCode::Math:
+		case ValueOpCode::NumberComparison:
+		case ValueOpCode::BooleanComparison:
+			return IsLane(op.Dest) && IsLane(op.A) && IsLane(op.B);
+
+		case ValueOpCode::Not:
+		case ValueOpCode::Convert:
+			return IsLane(op.Dest) && IsLane(op.A);
+
+		case ValueOpCode::LoadBool:
+		case ValueOpCode::LoadNumber:
+			return IsLane(op.Dest) && IsString(op.A);
+
+		case ValueOpCode::LoadBoolGlobal:
+		case ValueOpCode::LoadNumberGlobal:
+		case ValueOpCode::LoopIndex:
+			return IsLane(op.Dest);
+
+		default:
+			return false;
+	}
+}
+
+bool ScriptBatch::IsLane(uint32_t slot) const
+{
+	return slot < SlotKinds.size() && SlotKinds[slot] == SlotKind::Lane;
+}
+
+bool ScriptBatch::IsString(uint32_t slot) const
+{
+	return slot < SlotKinds.size() && SlotKinds[slot] == SlotKind::String;
+}
+
+void ScriptBatch::Step(size_t groupIndex)
+{
+	Group& group = Groups[groupIndex];
+	const Instruction ins = ScriptProgram::Unfuse(Program->Code[group.Pc]);
+	const std::vector<ScriptInstance*>& instances = *Instances;
+	Stats.Instructions++;
+
+	// loops evaluate their condition once the index has moved
+	if (ins.Op != OpCode::Loop)
+		EvaluateValues(group, ins.ValueBegin, ins.ValueEnd);
+
+	bool hasArg0 = ins.Args[0] != ScriptProgram::InvalidSlot;
+	bool hasArg1 = ins.Args[1] != ScriptProgram::InvalidSlot;
+	const uint32_t* mask = group.Mask.data();
+
+	uint32_t next = ScriptProgram::InvalidTarget;
+
+	switch (ins.Op)
+	{
+		case OpCode::Entry:
+		case OpCode::Jump:
+			next = ins.Next[0];
+			break;
+
+		case OpCode::Condition:
+			if (hasArg0)
+			{
+				Split(groupIndex, ins.Args[0], ins.Next[0], ins.Next[1], false);
+				return;
+			}
+			break;
+
+		case OpCode::Loop:
+		{
+			// every lane in the group has taken the same path, so they share one loop index
+			uint32_t index = uint32_t(++group.LoopFrames[ins.Frame]);
+			if (ins.Operand > 0 && index >= ins.Operand)
+			{
+				next = ins.Next[0];
+				break;
+			}
+
+			EvaluateValues(group, ins.ValueBegin, ins.ValueEnd);
+
+			if (hasArg0)
+			{
+				Split(groupIndex, ins.Args[0], ins.Next[1], ins.Next[0], true);
+				return;
+			}
+
+			group.ReturnStack.push_back(group.Pc);
+			next = ins.Next[1];
+			break;
+		}
+
+		case OpCode::PrintLog:
+			if (hasArg0)
+			{
+				std::string text;
+				for (uint32_t lane = group.Begin; lane < group.End; lane++)
+				{
+					if (mask[lane])
+						PrintLog::LogFunction(GetLaneValue(ins.Args[0], lane).String(text));
+				}
+			}
+
+			next = ins.Next[0];
+			break;
+
+		case OpCode::SaveBool:
+		case OpCode::SaveNumber:
+		case OpCode::SaveString:
+			if (hasArg0 && hasArg1)
+			{
+				std::string name;
+				std::string text;
+				const std::string& key = Program->Slots[ins.Args[0]].String(name);
+				for (uint32_t lane = group.Begin; lane < group.End; lane++)
+				{
+					if (!mask[lane])
+						continue;
+
+					ValueData value = GetLaneValue(ins.Args[1], lane);
+					if (ins.Op == OpCode::SaveBool)
+						instances[lane]->SetBool(key, value.Boolean());
+					else if (ins.Op == OpCode::SaveNumber)
+						instances[lane]->SetNumber(key, value.Number());
+					else
+						instances[lane]->SetString(key, value.String(text));
+				}
+			}
+
+			next = ins.Next[0];
+			break;
+
+		case OpCode::SaveBoolGlobal:
+		case OpCode::SaveNumberGlobal:
+		case OpCode::SaveStringGlobal:
+			if (hasArg1)
+			{
+				for (uint32_t lane = group.Begin; lane < group.End; lane++)
+				{
+					if (!mask[lane])
+						continue;
+
+					ScriptInstance& instance = *instances[lane];
+					ValueData value = GetLaneValue(ins.Args[1], lane);
+					if (ins.Op == OpCode::SaveBoolGlobal)
+						instance.BoolGlobalSlots[ins.Operand] = value.Boolean();
+					else if (ins.Op == OpCode::SaveNumberGlobal)
+						instance.NumGlobalSlots[ins.Operand] = value.Number();
+					else
+						instance.SetStringGlobal(ins.Operand, value, Program->IsConstant(ins.Args[1]));
+
+					instance.GlobalEpoch++;
+				}
+			}
+
+			next = ins.Next[0];
+			break;
+
+		default:
+			break;
+	}
+
+	SetNext(group, next);
+}
+
+void ScriptBatch::EvaluateValues(Group& group, uint32_t begin, uint32_t end)
+{
+	const std::vector<ScriptInstance*>& instances = *Instances;
+	const uint32_t* mask = group.Mask.data();
+
+	// whole vectors around the active lanes, the masks keep everything else untouched
+	uint32_t first = group.Begin & ~3u;
+	uint32_t last = std::min(Stride, (group.End + 3) & ~3u);
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const ValueOp& op = Program->ValueCode[i];
+		float* dest = Row(op.Dest);
+
+		switch (op.Op)
+		{
+			case ValueOpCode::Math:
+			{
+				const float* a = Row(op.A);
+				const float* b = Row(op.B);
+				switch (Math::Operation(op.Operator))
+				{
+					case Math::Operation::Add:
+						RunKernel<AddOp>(dest, a, b, mask, first, last);
+						break;
+					case Math::Operation::Subtract:
+						RunKernel<SubtractOp>(dest, a, b, mask, first, last);
+						break;
+					case Math::Operation::Multiply:
+						RunKernel<MultiplyOp>(dest, a, b, mask, first, last);
+						break;
+					case Math::Operation::Divide:
+						RunKernel<DivideOp>(dest, a, b, mask, first, last);
+						break;
+					default:
+						for (uint32_t lane = group.Begin; lane < group.End; lane++)
+						{
+							if (mask[lane])
+								dest[lane] = Math::Evaluate(Math::Operation(op.Operator), a[lane], b[lane]);
+						}
+						break;
+				}
+				break;
+			}
+
+			case ValueOpCode::NumberComparison:
+			{
+				const float* a = Row(op.A);
+				const float* b = Row(op.B);
+				switch (NumberComparison::Operation(op.Operator))
+				{
+					case NumberComparison::Operation::GreaterThan:
+						RunKernel<GreaterOp>(dest, a, b, mask, first, last);
+						break;
+					case NumberComparison::Operation::GreaterThanEqual:
+						RunKernel<GreaterEqualOp>(dest, a, b, mask, first, last);
+						break;
+					case NumberComparison::Operation::LessThan:
+						RunKernel<LessOp>(dest, a, b, mask, first, last);
+						break;
+					case NumberComparison::Operation::LessThanEqual:
+						RunKernel<LessEqualOp>(dest, a, b, mask, first, last);
+						break;
+					case NumberComparison::Operation::Equal:
+						RunKernel<EqualOp>(dest, a, b, mask, first, last);
+						break;
+					case NumberComparison::Operation::NotEqual:
+						RunKernel<NotEqualOp>(dest, a, b, mask, first, last);
+						break;
+					default:
+						for (uint32_t lane = group.Begin; lane < group.End; lane++)
+						{
+							if (mask[lane])
+								dest[lane] = 0.0f;
+						}
+						break;
+				}
+				break;
+			}
+
+			case ValueOpCode::BooleanComparison:
+				if (BooleanComparison::Operation(op.Operator) == BooleanComparison::Operation::AND)
+					RunKernel<AndOp>(dest, Row(op.A), Row(op.B), mask, first, last);
+				else
+					RunKernel<OrOp>(dest, Row(op.A), Row(op.B), mask, first, last);
+				break;
+
+			case ValueOpCode::Not:
+				RunKernel<NotOp>(dest, Row(op.A), Row(op.A), mask, first, last);
+				break;
+
+			case ValueOpCode::LoadBool:
+			case ValueOpCode::LoadNumber:
+			{
+				std::string name;
+				const std::string& key = Program->Slots[op.A].String(name);
+				for (uint32_t lane = group.Begin; lane < group.End; lane++)
+				{
+					if (!mask[lane])
+						continue;
+
+					if (op.Op == ValueOpCode::LoadBool)
+						dest[lane] = instances[lane]->GetBool(key) ? 1.0f : 0.0f;
+					else
+						dest[lane] = instances[lane]->GetNumber(key);
+				}
+				break;
+			}
+
+			case ValueOpCode::LoadBoolGlobal:
+				for (uint32_t lane = group.Begin; lane < group.End; lane++)
+				{
+					if (mask[lane])
+						dest[lane] = instances[lane]->BoolGlobalSlots[op.A] != 0 ? 1.0f : 0.0f;
+				}
+				break;
+
+			case ValueOpCode::LoadNumberGlobal:
+				for (uint32_t lane = group.Begin; lane < group.End; lane++)
+				{
+					if (mask[lane])
+						dest[lane] = instances[lane]->NumGlobalSlots[op.A];
+				}
+				break;
+
+			case ValueOpCode::Convert:
+			{
+				// bool lanes already hold 0 or 1, so only numbers to bools change anything
+				const float* a = Row(op.A);
+				bool toBool = op.Operator == uint8_t(ValueTypes::Boolean);
+				for (uint32_t lane = group.Begin; lane < group.End; lane++)
+				{
+					if (mask[lane])
+						dest[lane] = toBool ? (a[lane] != 0.0f ? 1.0f : 0.0f) : a[lane];
+				}
+				break;
+			}
+
+			case ValueOpCode::LoopIndex:
+			{
+				int32_t frame = group.LoopFrames[op.A];
+				float index = frame > 0 ? float(frame) : 0.0f;
+				for (uint32_t lane = group.Begin; lane < group.End; lane++)
+				{
+					if (mask[lane])
+						dest[lane] = index;
+				}
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+}
+
+void ScriptBatch::Split(size_t groupIndex, uint32_t slot, uint32_t whenTrue, uint32_t whenFalse, bool pushLoop)
+{
+	Group& group = Groups[groupIndex];
+	const float* condition = Row(slot);
+
+	Group other;
+	other.Mask.assign(Stride, 0);
+	for (uint32_t lane = group.Begin; lane < group.End; lane++)
+	{
+		// the same test as ValueData::Boolean on a number, NaN counts as true
+		if (group.Mask[lane] && !(condition[lane] != 0))
+		{
+			group.Mask[lane] = 0;
+			other.Mask[lane] = ~0u;
+		}
+	}
+
+	UpdateRange(group);
+	UpdateRange(other);
+
+	other.ReturnStack = group.ReturnStack;
+	other.LoopFrames = group.LoopFrames;
+	SetNext(other, whenFalse);
+
+	if (pushLoop)
+		group.ReturnStack.push_back(group.Pc);
+	SetNext(group, whenTrue);
+
+	if (other.Count == 0)
+		return;
+
+	if (group.Count == 0)
+	{
+		group = std::move(other);
+		return;
+	}
+
+	Stats.Splits++;
+	Groups.push_back(std::move(other));
+}
+
+void ScriptBatch::SetNext(Group& group, uint32_t next)
+{
+	if (next == ScriptProgram::InvalidTarget && !group.ReturnStack.empty())
+	{
+		next = group.ReturnStack.back();
+		group.ReturnStack.pop_back();
+	}
+
+	group.Pc = next;
+}
+
+size_t ScriptBatch::MergeGroups(size_t groupIndex)
+{
+	for (size_t i = Groups.size(); i-- > 0;)
+	{
+		if (i == groupIndex)
+			continue;
+
+		Group& group = Groups[groupIndex];
+		Group& other = Groups[i];
+		if (other.Pc != group.Pc || other.ReturnStack != group.ReturnStack || other.LoopFrames != group.LoopFrames)
+			continue;
+
+		for (uint32_t lane = other.Begin; lane < other.End; lane++)
+			group.Mask[lane] |= other.Mask[lane];
+
+		group.Count += other.Count;
+		group.Begin = std::min(group.Begin, other.Begin);
+		group.End = std::max(group.End, other.End);
+
+		Groups.erase(Groups.begin() + i);
+		if (i < groupIndex)
+			groupIndex--;
+
+		Stats.Merges++;
+	}
+
+	return groupIndex;
+}
+
+void ScriptBatch::UpdateRange(Group& group)
+{
+	group.Count = 0;
+	group.Begin = Stride;
+	group.End = 0;
+
+	for (uint32_t lane = 0; lane < Stride; lane++)
+	{
+		if (!group.Mask[lane])
+			continue;
+
+		group.Count++;
+		group.Begin = std::min(group.Begin, lane);
+		group.End = lane + 1;
+	}
+
+	if (group.Count == 0)
+		group.Begin = 0;
+}
+
+void ScriptBatch::Finish(Group& group)
+{
+	for (uint32_t lane = group.Begin; lane < group.End; lane++)
+	{
+		if (!group.Mask[lane])
+			continue;
+
+		ScriptInstance& instance = *(*Instances)[lane];
+		WriteBack(lane);
+
+		instance.ProgramCounter = ScriptProgram::InvalidTarget;
+		instance.CurrentNode = uint32_t(-1);
+		instance.GlobalEpoch++;
+
+		Results[lane] = instance.FinishStep();
+		Stats.Completed++;
+	}
+}
+
+void ScriptBatch::RunScalar(Group& group)
+{
+	// the instance picks up exactly where the group is, then runs the rest on its own
+	for (uint32_t lane = group.Begin; lane < group.End; lane++)
+	{
+		if (!group.Mask[lane])
+			continue;
+
+		ScriptInstance& instance = *(*Instances)[lane];
+		WriteBack(lane);
+
+		instance.ReturnStack = group.ReturnStack;
+		instance.LoopFrames = group.LoopFrames;
+		instance.ProgramCounter = group.Pc;
+		instance.CurrentNode = Program->Code[group.Pc].NodeId;
+		instance.Execute(uint32_t(-1));
+
+		Results[lane] = instance.FinishStep();
+		Stats.ScalarLanes++;
+		if (Results[lane] == ScriptInstance::Result::Complete)
+			Stats.Completed++;
+	}
+}
+
+void ScriptBatch::WriteBack(uint32_t lane)
+{
+	ScriptInstance& instance = *(*Instances)[lane];
+	for (uint32_t slot : LaneSlots)
+		instance.Slots[slot] = GetLaneValue(slot, lane);
+}
+
+ValueData ScriptBatch::GetLaneValue(uint32_t slot, uint32_t lane)
+{
+	if (SlotKinds[slot] != SlotKind::Lane)
+		return Program->Slots[slot];
+
+	float value = Row(slot)[lane];
+	if (Program->Slots[slot].Type == ValueTypes::Boolean)
+		return ValueData(value != 0);
+
+	return ValueData(value);
+}
@@ -0,0 +1,868 @@
+#include "script_program.h"
+#include "script_jit.h"
+
+#include <algorithm>
+#include <typeinfo>
+
+namespace
+{
+	OpCode GetOpCode(const Node* node)
+	{
+		// exact type matches only, a derived node may override Process
+		const std::type_info& type = typeid(*node);
+
+		if (type == typeid(EntryNode))
+			return OpCode::Entry;
+		if (type == typeid(Condition))
+			return OpCode::Condition;
+		if (type == typeid(Loop))
+			return OpCode::Loop;
+		if (type == typeid(Delay))
+			return OpCode::Delay;
+		if (type == typeid(PrintLog))
+			return OpCode::PrintLog;
+		if (type == typeid(SaveBool))
+			return OpCode::SaveBool;
+		if (type == typeid(SaveNumber))
+			return OpCode::SaveNumber;
+		if (type == typeid(SaveString))
+			return OpCode::SaveString;
+
+		return OpCode::Native;
+	}
+
+	uint64_t GetValueKey(uint32_t nodeIndex, uint32_t valueId)
+	{
+		return (uint64_t(nodeIndex) << 32) | valueId;
+	}
+
+	// the type a value op always leaves in its destination
+	ValueTypes GetResultType(const ValueOp& op)
+	{
+		switch (op.Op)
+		{
+			case ValueOpCode::NumberComparison:
+			case ValueOpCode::BooleanComparison:
+			case ValueOpCode::Not:
+			case ValueOpCode::LoadBool:
+			case ValueOpCode::LoadBoolGlobal:
+				return ValueTypes::Boolean;
+
+			case ValueOpCode::LoadString:
+			case ValueOpCode::LoadStringGlobal:
+				return ValueTypes::String;
+
+			case ValueOpCode::Convert:
+				return ValueTypes(op.Operator);
+
+			default:
+				return ValueTypes::Number;
+		}
+	}
+
+	const char* GetTypeName(ValueTypes type)
+	{
+		switch (type)
+		{
+			case ValueTypes::Boolean:
+				return "Boolean";
+			case ValueTypes::Number:
+				return "Number";
+			default:
+				return "String";
+		}
+	}
+
+	enum class CacheState : uint8_t
+	{
+		Unvisited,
+		Visiting,
+		Uncacheable,
+		Cacheable,
+		CacheableUntilWrite,
+	};
+
+	// a value can be cached when its node and everything upstream of it is pure or only reads globals
+	CacheState ClassifyValue(const ScriptGraph& graph, Node* node, std::vector<CacheState>& states)
+	{
+		CacheState& current = states[node->Index];
+		if (current != CacheState::Unvisited)
+			return current == CacheState::Visiting ? CacheState::Uncacheable : current;
+
+		current = CacheState::Visiting;
+
+		CacheState state = CacheState::Uncacheable;
+		if (node->IsPure())
+			state = CacheState::Cacheable;
+		else if (node->ReadsGlobals())
+			state = CacheState::CacheableUntilWrite;
+
+		for (const ValueRef& arg : node->Arguments)
+		{
+			if (state == CacheState::Uncacheable)
+				break;
+
+			Node* input = graph.GetNode(arg);
+			if (!input)
+				continue;
+
+			CacheState inputState = ClassifyValue(graph, input, states);
+			if (inputState == CacheState::Uncacheable)
+				state = CacheState::Uncacheable;
+			else if (inputState == CacheState::CacheableUntilWrite)
+				state = CacheState::CacheableUntilWrite;
+		}
+
+		states[node->Index] = state;
+		return state;
+	}
+}
+
+bool ScriptProgram::Compile(const ScriptGraph& graph)
+{
+	Code.clear();
+	ValueCode.clear();
+	Slots.clear();
+	DynamicSlots.clear();
+	EntryPoints.clear();
+	EntryTable.clear();
+	NodeInstructions.assign(graph.NodeTable.size(), InvalidTarget);
+	ValueSlots.clear();
+	ConstantSlots.clear();
+	ConvertedSlots.clear();
+	Conversions.clear();
+	Globals = GlobalSymbols();
+
+	// every node value gets a slot up front, native nodes write their results straight into it
+	NodeSlots.assign(1, 0);
+	for (Node* node : graph.NodeTable)
+	{
+		for (const ValueDef& value : node->Values)
+			AddSlot(value.Type);
+
+		NodeSlots.push_back(uint32_t(Slots.size()));
+	}
+
+	// loops keep their counters in numbered frames rather than a map from node ids
+	NodeLoopFrames.assign(graph.NodeTable.size(), InvalidSlot);
+	LoopFrameCount = 0;
+	for (Node* node : graph.NodeTable)
+	{
+		if (dynamic_cast<Loop*>(node))
+			NodeLoopFrames[node->Index] = LoopFrameCount++;
+	}
+
+	// lay the flow out depth first from each entry so that the first output is usually the next instruction
+	std::vector<Node*> pending;
+	for (const auto& [name, entry] : graph.EntryNodes)
+	{
+		if (!entry)
+			continue;
+
+		pending.push_back(entry);
+		while (!pending.empty())
+		{
+			Node* node = pending.back();
+			pending.pop_back();
+
+			if (NodeInstructions[node->Index] != InvalidTarget)
+				continue;
+
+			NodeInstructions[node->Index] = uint32_t(Code.size());
+
+			Instruction ins;
+			ins.Op = GetOpCode(node);
+			ins.NodeId = node->ID;
+			ins.Source = node;
+			if (ins.Op == OpCode::Loop)
+			{
+				ins.Operand = static_cast<Loop*>(node)->Itterations;
+				ins.Frame = NodeLoopFrames[node->Index];
+			}
+
+			Code.push_back(ins);
+
+			for (auto itr = node->OutputNodeRefs.rbegin(); itr != node->OutputNodeRefs.rend(); ++itr)
+			{
+				Node* next = graph.GetNode(*itr);
+				if (next && NodeInstructions[next->Index] == InvalidTarget)
+					pending.push_back(next);
+			}
+		}
+
+		// handles follow name order, so they only move when entry points are added or removed
+		EntryPoints[name] = uint32_t(EntryTable.size());
+		EntryTable.push_back(NodeInstructions[entry->Index]);
+	}
+
+	// resolve the jump targets now that every reachable node has an instruction
+	for (Instruction& ins : Code)
+	{
+		for (size_t i = 0; i < 2 && i < ins.Source->OutputNodeRefs.size(); i++)
+		{
+			Node* next = graph.GetNode(ins.Source->OutputNodeRefs[i]);
+			if (next)
+				ins.Next[i] = NodeInstructions[next->Index];
+		}
+
+		// native nodes pull their own arguments, and can write anything into their own values
+		if (ins.Op == OpCode::Native)
+			MarkDynamic(ins.Source);
+
+		if (ins.Op == OpCode::Native || ins.Op == OpCode::Entry)
+			continue;
+
+		// each instruction gets its own flat program, a value shared by several arguments is only computed once
+		EmittedValues.clear();
+		ins.ValueBegin = uint32_t(ValueCode.size());
+		for (size_t i = 0; i < 2 && i < ins.Source->Arguments.size(); i++)
+			ins.Args[i] = CompileArgument(graph, ins.Source->Arguments[i]);
+		ins.ValueEnd = uint32_t(ValueCode.size());
+
+		// a condition on a constant always takes the same branch
+		if (ins.Op == OpCode::Condition && ins.Args[0] != InvalidSlot && ConstantSlots[ins.Args[0]])
+		{
+			ins.Op = OpCode::Jump;
+			ins.Next[0] = Slots[ins.Args[0]].Boolean() ? ins.Next[0] : ins.Next[1];
+			ins.Next[1] = InvalidTarget;
+		}
+
+		// saves to a name known at compile time go straight to a global index
+		if (ins.Args[0] != InvalidSlot && ConstantSlots[ins.Args[0]])
+		{
+			switch (ins.Op)
+			{
+				case OpCode::SaveBool:
+					ins.Op = OpCode::SaveBoolGlobal;
+					ins.Operand = BindGlobal(Globals.Bools, ins.Args[0]);
+					break;
+				case OpCode::SaveNumber:
+					ins.Op = OpCode::SaveNumberGlobal;
+					ins.Operand = BindGlobal(Globals.Numbers, ins.Args[0]);
+					break;
+				case OpCode::SaveString:
+					ins.Op = OpCode::SaveStringGlobal;
+					ins.Operand = BindGlobal(Globals.Strings, ins.Args[0]);
+					break;
+				default:
+					break;
+			}
+		}
+	}
+
+	EmittedValues.clear();
+
+	if (graph.UseFusion)
+		FuseInstructions();
+
+	BuildValueCache(graph);
+
+	Hash = ComputeHash();
+	PrecompiledEntries.assign(EntryTable.size(), nullptr);
+	for (const auto& [name, handle] : EntryPoints)
+		PrecompiledEntries[handle] = NodeRegistry::FindPrecompiledEntry(Hash, name);
+
+	if (graph.UseJit && ScriptJit::IsAvailable())
+	{
+		auto jit = std::make_shared<ScriptJit>();
+		if (jit->Compile(*this))
+			Jit = jit;
+	}
+
+	return true;
+}
+
+void ScriptProgram::MarkDynamic(const Node* node)
+{
+	if (!node || node->Index + 1 >= NodeSlots.size())
+		return;
+
+	for (uint32_t slot = NodeSlots[node->Index]; slot < NodeSlots[node->Index + 1]; slot++)
+		DynamicSlots[slot] = true;
+}
+
+void ScriptProgram::FuseInstructions()
+{
+	for (Instruction& ins : Code)
+	{
+		switch (ins.Op)
+		{
+			case OpCode::Condition:
+			{
+				if (ins.Args[0] == InvalidSlot || ins.ValueBegin == ins.ValueEnd)
+					break;
+
+				// branch on the comparison directly instead of going through a bool slot
+				const ValueOp& compare = ValueCode[ins.ValueEnd - 1];
+				if (compare.Op != ValueOpCode::NumberComparison || compare.Dest != ins.Args[0])
+					break;
+
+				ins.Op = OpCode::CompareBranch;
+				ins.Fused = ins.ValueEnd - 1;
+				ins.ValueEnd = ins.Fused;
+				Fusions.push_back({ "NumberComparison>Condition", ins.NodeId });
+				break;
+			}
+
+			case OpCode::SaveNumberGlobal:
+			{
+				if (ins.Args[1] == InvalidSlot || ins.ValueEnd - ins.ValueBegin < 2)
+					break;
+
+				const ValueOp& math = ValueCode[ins.ValueEnd - 1];
+				if (math.Op != ValueOpCode::Math || math.Dest != ins.Args[1])
+					break;
+
+				uint32_t load = InvalidTarget;
+				for (uint32_t i = ins.ValueEnd - 1; i-- > ins.ValueBegin;)
+				{
+					const ValueOp& op = ValueCode[i];
+					if (op.Op == ValueOpCode::LoadNumberGlobal && (op.Dest == math.A || op.Dest == math.B))
+					{
+						load = i;
+						break;
+					}
+				}
+
+				if (load == InvalidTarget)
+					break;
+
+				// the load can only move down to the math if nothing in between uses it or could write a global
+				bool movable = true;
+				for (uint32_t i = load + 1; i < ins.ValueEnd - 1; i++)
+				{
+					const ValueOp& op = ValueCode[i];
+					if (op.Op == ValueOpCode::Native || op.A == ValueCode[load].Dest || op.B == ValueCode[load].Dest)
+						movable = false;
+				}
+
+				if (!movable)
+					break;
+
+				std::rotate(ValueCode.begin() + load, ValueCode.begin() + load + 1, ValueCode.begin() + (ins.ValueEnd - 1));
+
+				ins.Op = OpCode::NumberGlobalUpdate;
+				ins.Fused = ins.ValueEnd - 2;
+				ins.ValueEnd = ins.Fused;
+				Fusions.push_back({ "LoadNumber>Math>SaveNumber", ins.NodeId });
+				break;
+			}
+
+			case OpCode::Loop:
+			{
+				if (ins.Next[1] == InvalidTarget)
+					break;
+
+				// a body that is one print goes straight back to the loop, so it never needs the return stack
+				const Instruction& body = Code[ins.Next[1]];
+				if (body.Op != OpCode::PrintLog || body.Next[0] != InvalidTarget || body.Args[0] == InvalidSlot)
+					break;
+
+				ins.Op = OpCode::LoopPrint;
+				ins.Fused = ins.Next[1];
+				Fusions.push_back({ "Loop>PrintLog", ins.NodeId });
+				break;
+			}
+
+			default:
+				break;
+		}
+	}
+}
+
+std::string ScriptProgram::GetFusionReport() const
+{
+	if (Fusions.empty())
+		return "no fusions\n";
+
+	std::map<std::string, std::vector<uint32_t>> patterns;
+	for (const FusionInfo& fusion : Fusions)
+		patterns[fusion.Pattern].push_back(fusion.NodeId);
+
+	std::string report;
+	for (const auto& [pattern, nodes] : patterns)
+	{
+		report += pattern + " x" + std::to_string(nodes.size()) + ", nodes";
+		for (uint32_t node : nodes)
+			report += " " + std::to_string(node);
+		report += "\n";
+	}
+
+	return report;
+}
+
+Instruction ScriptProgram::Unfuse(const Instruction& ins)
+{
+	Instruction plain = ins;
+	switch (ins.Op)
+	{
+		case OpCode::CompareBranch:
+			plain.Op = OpCode::Condition;
+			plain.ValueEnd = ins.Fused + 1;
+			break;
+
+		case OpCode::NumberGlobalUpdate:
+			plain.Op = OpCode::SaveNumberGlobal;
+			plain.ValueEnd = ins.Fused + 2;
+			break;
+
+		case OpCode::LoopPrint:
+			plain.Op = OpCode::Loop;
+			break;
+
+		default:
+			return ins;
+	}
+
+	plain.Fused = uint32_t(-1);
+	return plain;
+}
+
+uint64_t ScriptProgram::ComputeHash() const
+{
+	// FNV-1a over everything the generated code depends on
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+	};
+	auto mixValue = [&mix](uint32_t value) { mix(&value, sizeof(value)); };
+	auto mixString = [&mix, &mixValue](const std::string& text) { mixValue(uint32_t(text.size())); mix(text.data(), text.size()); };
+
+	for (const Instruction& ins : Code)
+	{
+		mixValue(uint32_t(ins.Op));
+		mixValue(ins.Next[0]);
+		mixValue(ins.Next[1]);
+		mixValue(ins.Operand);
+		mixValue(ins.ValueBegin);
+		mixValue(ins.ValueEnd);
+		mixValue(ins.Args[0]);
+		mixValue(ins.Args[1]);
+		mixValue(ins.Fused);
+		mixValue(ins.Frame);
+	}
+
+	for (const ValueOp& op : ValueCode)
+	{
+		mixValue(uint32_t(op.Op));
+		mixValue(op.Operator);
+		mixValue(op.Dest);
+		mixValue(op.A);
+		mixValue(op.B);
+		mixValue(op.NodeId);
+		mixValue(op.ValueId);
+	}
+
+	for (const ValueData& value : Slots)
+	{
+		mixValue(uint32_t(value.Type));
+		if (value.Type == ValueTypes::Boolean)
+			mixValue(value.BoolValue ? 1 : 0);
+		else if (value.Type == ValueTypes::Number)
+			mix(&value.NumberValue, sizeof(value.NumberValue));
+		else
+			mixString(*value.StringValue);
+	}
+
+	for (const auto& [name, handle] : EntryPoints)
+	{
+		mixString(name);
+		mixValue(EntryTable[handle]);
+	}
+
+	// the symbol tables are unordered, so order them by index first
+	for (const auto* table : { &Globals.Bools, &Globals.Numbers, &Globals.Strings })
+	{
+		std::vector<const std::string*> names(table->size());
+		for (const auto& [name, index] : *table)
+			names[index] = &name;
+
+		mixValue(uint32_t(names.size()));
+		for (const std::string* name : names)
+			mixString(*name);
+	}
+
+	return hash;
+}
+
+void ScriptProgram::BuildValueCache(const ScriptGraph& graph)
+{
+	CachedValues.assign(graph.NodeTable.size(), ValueCacheInfo());
+	CacheSize = 0;
+
+	std::vector<CacheState> states(graph.NodeTable.size(), CacheState::Unvisited);
+	for (Node* node : graph.NodeTable)
+	{
+		if (node->Values.empty())
+			continue;
+
+		CacheState state = ClassifyValue(graph, node, states);
+		if (state == CacheState::Uncacheable)
+			continue;
+
+		// every value of a node gets an entry, laid out next to each other
+		ValueCacheInfo& info = CachedValues[node->Index];
+		info.Index = CacheSize;
+		info.Count = uint32_t(node->Values.size());
+		info.DependsOnGlobals = state == CacheState::CacheableUntilWrite;
+		CacheSize += info.Count;
+	}
+}
+
+uint32_t ScriptProgram::GetSlot(uint32_t nodeIndex, uint32_t valueId, ValueTypes type)
+{
+	uint32_t nodeSlot = FindNodeSlot(nodeIndex, valueId);
+	if (nodeSlot != InvalidSlot)
+		return nodeSlot;
+
+	// refs to values a node does not declare still get a register of their own
+	uint64_t key = GetValueKey(nodeIndex, valueId);
+
+	auto itr = ValueSlots.find(key);
+	if (itr != ValueSlots.end())
+		return itr->second;
+
+	uint32_t slot = AddSlot(type);
+	ValueSlots[key] = slot;
+	return slot;
+}
+
+uint32_t ScriptProgram::AddSlot(ValueTypes type)
+{
+	uint32_t slot = uint32_t(Slots.size());
+	ConstantSlots.push_back(false);
+	DynamicSlots.push_back(false);
+
+	ValueData& value = Slots.emplace_back();
+	switch (type)
+	{
+		case ValueTypes::Boolean:
+			value.SetBool(false);
+			break;
+		case ValueTypes::Number:
+			value.SetNumber(0);
+			break;
+		case ValueTypes::String:
+			value.SetString(StringPool::Empty());
+			break;
+	}
+
+	return slot;
+}
+
+uint32_t ScriptProgram::BindGlobal(std::unordered_map<std::string, uint32_t>& table, uint32_t nameSlot)
+{
+	std::string scratch;
+	const std::string& name = Slots[nameSlot].String(scratch);
+
+	auto itr = table.find(name);
+	if (itr != table.end())
+		return itr->second;
+
+	uint32_t index = uint32_t(table.size());
+	table[name] = index;
+	return index;
+}
+
+bool ScriptProgram::FoldConstant(const ValueOp& op)
+{
+	bool constantA = op.A != InvalidSlot && ConstantSlots[op.A];
+	bool constantB = op.B != InvalidSlot && ConstantSlots[op.B];
+
+	ValueData& dest = Slots[op.Dest];
+
+	switch (op.Op)
+	{
+		case ValueOpCode::Math:
+			if (!constantA || !constantB)
+				return false;
+			dest.SetNumber(Math::Evaluate(Math::Operation(op.Operator), Slots[op.A].Number(), Slots[op.B].Number()));
+			break;
+
+		case ValueOpCode::NumberComparison:
+			if (!constantA || !constantB)
+				return false;
+			dest.SetBool(NumberComparison::Evaluate(NumberComparison::Operation(op.Operator), Slots[op.A].Number(), Slots[op.B].Number()));
+			break;
+
+		case ValueOpCode::BooleanComparison:
+			if (!constantA || !constantB)
+				return false;
+			dest.SetBool(BooleanComparison::Evaluate(BooleanComparison::Operation(op.Operator), Slots[op.A].Boolean(), Slots[op.B].Boolean()));
+			break;
+
+		case ValueOpCode::Not:
+			if (!constantA)
+				return false;
+			dest.SetBool(!Slots[op.A].Boolean());
+			break;
+
+		default:
+			return false;
+	}
+
+	ConstantSlots[op.Dest] = true;
+	return true;
+}
+
+uint32_t ScriptProgram::CompileValue(const ScriptGraph& graph, const ValueRef& ref)
+{
+	Node* node = graph.GetNode(ref);
+	if (!node)
+		return InvalidSlot;
+
+	uint64_t key = GetValueKey(node->Index, ref.ValueId);
+
+	ValueTypes type = ref.ValueId < node->Values.size() ? node->Values[ref.ValueId].Type : ref.RefType;
+	uint32_t slot = GetSlot(node->Index, ref.ValueId, type);
+
+	// already computed by this instruction, or a cycle back to a value we are still compiling
+	auto emitted = EmittedValues.find(key);
+	if (emitted != EmittedValues.end())
+		return emitted->second ? slot : InvalidSlot;
+
+	EmittedValues[key] = false;
+
+	// folded by an earlier instruction
+	if (ConstantSlots[slot])
+	{
+		EmittedValues[key] = true;
+		return slot;
+	}
+
+	ValueOp op;
+	op.Dest = slot;
+	op.NodeId = ref.ID;
+	op.ValueId = ref.ValueId;
+	op.Source = node;
+
+	const std::type_info& nodeType = typeid(*node);
+
+	// literals live in their slot for the life of the instance
+	if (nodeType == typeid(BooleanLiteral))
+	{
+		Slots[slot].SetBool(static_cast<BooleanLiteral*>(node)->GetValue());
+		ConstantSlots[slot] = true;
+	}
+	else if (nodeType == typeid(NumberLiteral))
+	{
+		Slots[slot].SetNumber(static_cast<NumberLiteral*>(node)->GetValue());
+		ConstantSlots[slot] = true;
+	}
+	else if (nodeType == typeid(StringLiteral))
+	{
+		Slots[slot].SetString(static_cast<StringLiteral*>(node)->GetValue());
+		ConstantSlots[slot] = true;
+	}
+	else if (nodeType == typeid(Loop))
+	{
+		op.Op = ValueOpCode::LoopIndex;
+		op.A = NodeLoopFrames[node->Index];
+		ValueCode.push_back(op);
+	}
+	else if (nodeType == typeid(Math) || nodeType == typeid(NumberComparison) || nodeType == typeid(BooleanComparison))
+	{
+		op.A = CompileArgument(graph, node->Arguments[0]);
+		op.B = CompileArgument(graph, node->Arguments[1]);
+
+		if (nodeType == typeid(Math))
+		{
+			op.Op = ValueOpCode::Math;
+			op.Operator = uint8_t(static_cast<Math*>(node)->Operator);
+		}
+		else if (nodeType == typeid(NumberComparison))
+		{
+			op.Op = ValueOpCode::NumberComparison;
+			op.Operator = uint8_t(static_cast<NumberComparison*>(node)->Operator);
+		}
+		else
+		{
+			op.Op = ValueOpCode::BooleanComparison;
+			op.Operator = uint8_t(static_cast<BooleanComparison*>(node)->Operator);
+		}
+
+		// a missing input leaves the result at its default value
+		if (op.A == InvalidSlot || op.B == InvalidSlot)
+			ConstantSlots[slot] = true;
+		else if (!FoldConstant(op))
+			ValueCode.push_back(op);
+	}
+	else if (nodeType == typeid(NotComparison) || nodeType == typeid(LoadBool) || nodeType == typeid(LoadNumber) || nodeType == typeid(LoadString))
+	{
+		op.A = CompileArgument(graph, node->Arguments[0]);
+
+		if (nodeType == typeid(NotComparison))
+			op.Op = ValueOpCode::Not;
+		else if (nodeType == typeid(LoadBool))
+			op.Op = ValueOpCode::LoadBool;
+		else if (nodeType == typeid(LoadNumber))
+			op.Op = ValueOpCode::LoadNumber;
+		else
+			op.Op = ValueOpCode::LoadString;
+
+		if (op.A == InvalidSlot)
+		{
+			ConstantSlots[slot] = true;
+		}
+		else if (op.Op != ValueOpCode::Not && ConstantSlots[op.A])
+		{
+			// loads from a name known at compile time read a global index instead of hashing the name
+			if (op.Op == ValueOpCode::LoadBool)
+			{
+				op.Op = ValueOpCode::LoadBoolGlobal;
+				op.A = BindGlobal(Globals.Bools, op.A);
+			}
+			else if (op.Op == ValueOpCode::LoadNumber)
+			{
+				op.Op = ValueOpCode::LoadNumberGlobal;
+				op.A = BindGlobal(Globals.Numbers, op.A);
+			}
+			else
+			{
+				op.Op = ValueOpCode::LoadStringGlobal;
+				op.A = BindGlobal(Globals.Strings, op.A);
+			}
+			ValueCode.push_back(op);
+		}
+		else if (!FoldConstant(op))
+		{
+			ValueCode.push_back(op);
+		}
+	}
+	else
+	{
+		op.Op = ValueOpCode::Native;
+		ValueCode.push_back(op);
+		MarkDynamic(node);
+	}
+
+	// a node read through a value it does not declare can write a different type than its slot was made with
+	if (!ConstantSlots[slot] && (op.Op == ValueOpCode::Native || GetResultType(op) != Slots[slot].Type))
+		DynamicSlots[slot] = true;
+
+	EmittedValues[key] = true;
+	return slot;
+}
+
+uint32_t ScriptProgram::CompileArgument(const ScriptGraph& graph, const ValueRef& ref)
+{
+	uint32_t slot = CompileValue(graph, ref);
+	if (slot == InvalidSlot)
+		return slot;
+
+	// constants always have the type they were folded to
+	bool typed = ConstantSlots[slot] || !DynamicSlots[slot];
+	if (typed && Slots[slot].Type == ref.RefType)
+		return slot;
+
+	// strings are built where they are used, converting to one at runtime would intern every value it ever saw
+	if (ref.RefType == ValueTypes::String && !ConstantSlots[slot])
+		return slot;
+
+	return ConvertValue(slot, ref, graph.GetNode(ref));
+}
+
+uint32_t ScriptProgram::ConvertValue(uint32_t slot, const ValueRef& ref, Node* source)
+{
+	uint64_t key = (uint64_t(slot) << 2) | uint64_t(ref.RefType);
+
+	uint32_t converted = InvalidSlot;
+	auto itr = ConvertedSlots.find(key);
+	if (itr != ConvertedSlots.end())
+	{
+		converted = itr->second;
+	}
+	else
+	{
+		converted = AddSlot(ref.RefType);
+		ConvertedSlots[key] = converted;
+
+		TypeConversion conversion;
+		conversion.NodeId = ref.ID;
+		conversion.ValueId = ref.ValueId;
+		conversion.From = Slots[slot].Type;
+		conversion.To = ref.RefType;
+		conversion.Dynamic = !ConstantSlots[slot] && DynamicSlots[slot];
+		conversion.Folded = ConstantSlots[slot];
+		Conversions.push_back(conversion);
+
+		if (ConstantSlots[slot])
+		{
+			const ValueData& value = Slots[slot];
+			switch (ref.RefType)
+			{
+				case ValueTypes::Boolean:
+					Slots[converted].SetBool(value.Boolean());
+					break;
+				case ValueTypes::Number:
+					Slots[converted].SetNumber(value.Number());
+					break;
+				default:
+				{
+					std::string scratch;
+					Slots[converted].SetString(value.String(scratch));
+					break;
+				}
+			}
+			ConstantSlots[converted] = true;
+		}
+	}
+
+	if (ConstantSlots[converted])
+		return converted;
+
+	// conversions are keyed past the last node so they share the per instruction bookkeeping with values
+	uint64_t emittedKey = GetValueKey(InvalidSlot, converted);
+	if (EmittedValues.count(emittedKey))
+		return converted;
+
+	ValueOp op;
+	op.Op = ValueOpCode::Convert;
+	op.Operator = uint8_t(ref.RefType);
+	op.Dest = converted;
+	op.A = slot;
+	op.NodeId = ref.ID;
+	op.ValueId = ref.ValueId;
+	op.Source = source;
+	ValueCode.push_back(op);
+
+	EmittedValues[emittedKey] = true;
+	return converted;
+}
+
+std::string ScriptProgram::GetTypeReport() const
+{
+	if (Conversions.empty())
+		return "no conversions\n";
+
+	std::string report;
+	for (const TypeConversion& conversion : Conversions)
+	{
+		report += "node " + std::to_string(conversion.NodeId) + " value " + std::to_string(conversion.ValueId) + ": ";
+		report += conversion.Dynamic ? std::string("dynamic") : std::string(GetTypeName(conversion.From));
+		report += std::string(" to ") + GetTypeName(conversion.To);
+		report += conversion.Folded ? " (folded)\n" : "\n";
+	}
+
+	return report;
+}
+
+uint32_t ScriptProgram::FindEntryPoint(const std::string& name) const
+{
+	return GetEntryPoint(FindEntryHandle(name));
+}
+
+uint32_t ScriptProgram::FindEntryHandle(const std::string& name) const
+{
+	auto itr = EntryPoints.find(name);
+	if (itr == EntryPoints.end())
+		return ScriptGraph::InvalidEntry;
+
+	return itr->second;
+}
@@ -3,25 +3,66 @@
 
 #include "script_graph.h"
 #include <memory>
+#include <cstring>
+#include <cmath>
+#include <mutex>
+#include <unordered_set>
 
-std::string NumberValueData::Text;
-float StringValueData::ValueF = 0;
+namespace StringPool
+{
+	struct Shard
+	{
+		std::mutex Lock;
+		std::unordered_set<std::string> Strings;
+	};
+
+	// sharded so instances on different threads rarely wait on each other
+	static constexpr size_t ShardCount = 16;
+
+	Shard* GetShards()
+	{
+		static Shard shards[ShardCount];
+		return shards;
+	}
+
+	const std::string* Intern(const std::string& text)
+	{
+		Shard& shard = GetShards()[std::hash<std::string>()(text) % ShardCount];
+
+		std::lock_guard<std::mutex> lock(shard.Lock);
+		return &*shard.Strings.insert(text).first;
+	}
+
+	const std::string* Empty()
+	{
+		static const std::string* empty = Intern(std::string());
+		return empty;
+	}
+}
 
 void Node::Read(void* data, size_t size, size_t& offset)
 {
 	AllowInput = ReadBool(data, size, offset);
 	
-	uint32_t outNodes = ReadUInt(data, size, offset);
-	if (outNodes > OutputNodeRefs.size())
-		outNodes = (uint32_t)OutputNodeRefs.size();
+	uint32_t outNodes = ReadCount(data, size, offset);
+	if (outNodes != OutputNodeRefs.size() && LoadError.empty())
+		LoadError = "has " + std::to_string(outNodes) + " outputs, expected " + std::to_string(OutputNodeRefs.size());
 	for (uint32_t i = 0; i < outNodes; i++)
-		OutputNodeRefs[i].ID = ReadUInt(data, size, offset);
+	{
+		uint32_t id = ReadUInt(data, size, offset);
+		if (i < OutputNodeRefs.size())
+			OutputNodeRefs[i].ID = id;
+	}
 
-	uint32_t args = ReadUInt(data, size, offset);
-	if (args > Arguments.size())
-		args = (uint32_t)Arguments.size();
+	uint32_t args = ReadCount(data, size, offset);
+	if (args != Arguments.size() && LoadError.empty())
+		LoadError = "has " + std::to_string(args) + " arguments, expected " + std::to_string(Arguments.size());
 	for (uint32_t i = 0; i < args; i++)
-		Arguments[i].ID = ReadUInt(data, size, offset);
+	{
+		uint32_t id = ReadUInt(data, size, offset);
+		if (i < Arguments.size())
+			Arguments[i].ID = id;
+	}
 
 	NodePosX = ReadFloat(data, size, offset);
 	NodePosY = ReadFloat(data, size, offset);
@@ -68,9 +109,8 @@ void Node::WriteBool(bool value, void* data, size_t& offset)
 
 void Node::WriteUInt(uint32_t value, void* data, size_t& offset)
 {
-	uint32_t* buffer = (uint32_t*)((char*)data + offset);
+	memcpy((char*)data + offset, &value, 4);
 	offset += 4;
-	*buffer = value;
 }
 
 void Node::WriteUInt(size_t value, void* data, size_t& offset)
@@ -80,9 +120,8 @@ void Node::WriteUInt(size_t value, void* data, size_t& offset)
 
 void Node::WriteFloat(float value, void* data, size_t& offset)
 {
-	float* buffer = (float*)((char*)data + offset);
+	memcpy((char*)data + offset, &value, 4);
 	offset += 4;
-	*buffer = value;
 }
 
 void Node::WriteString(const std::string& value, void* data, size_t& offset)
@@ -92,39 +131,70 @@ void Node::WriteString(const std::string& value, void* data, size_t& offset)
 	offset += value.size();
 }
 
-bool Node::ReadBool(void* data, size_t size, size_t& offset)
+bool Node::ReadData(void* value, size_t valueSize, void* data, size_t size, size_t& offset)
 {
-	if (offset >= size)
+	if (offset > size || valueSize > size - offset)
+	{
+		if (LoadError.empty())
+			LoadError = "data ends early";
+
+		offset = size;
 		return false;
+	}
 
-	unsigned char* buffer = static_cast<unsigned char*>(data) + offset;
-	offset++;
-	return *buffer != 0;
+	memcpy(value, (char*)data + offset, valueSize);
+	offset += valueSize;
+	return true;
+}
+
+bool Node::ReadBool(void* data, size_t size, size_t& offset)
+{
+	unsigned char value = 0;
+	ReadData(&value, 1, data, size, offset);
+	return value != 0;
 }
 
 uint32_t Node::ReadUInt(void* data, size_t size, size_t& offset)
 {
-	if (offset >= size)
-		return 0;
+	uint32_t value = 0;
+	ReadData(&value, 4, data, size, offset);
+	return value;
+}
 
-	uint32_t* buffer = (uint32_t*)((char*)data + offset);
-	offset += 4;
-	return *buffer;
+uint32_t Node::ReadCount(void* data, size_t size, size_t& offset)
+{
+	uint32_t count = ReadUInt(data, size, offset);
+
+	// a count can never be more than the IDs left to read
+	size_t left = (size - offset) / 4;
+	if (count > left)
+	{
+		if (LoadError.empty())
+			LoadError = "count of " + std::to_string(count) + " is past the end of the data";
+		count = uint32_t(left);
+	}
+	return count;
 }
 
 float Node::ReadFloat(void* data, size_t size, size_t& offset)
 {
-	if (offset >= size)
-		return 0;
-
-	float* buffer = (float*)((char*)data + offset);
-	offset += 4;
-	return *buffer;
+	float value = 0;
+	ReadData(&value, 4, data, size, offset);
+	return value;
 }
 
 std::string Node::ReadString(void* data, size_t size, size_t& offset)
 {
 	uint32_t len = ReadUInt(data, size, offset);
+	if (len > size - offset)
+	{
+		if (LoadError.empty())
+			LoadError = "string of " + std::to_string(len) + " bytes is past the end of the data";
+
+		offset = size;
+		return std::string();
+	}
+
 	std::string value((char*)data + offset, len);
 	offset += len;
 	return value;
@@ -136,7 +206,7 @@ EntryNode::EntryNode()
 	OutputNodeRefs.emplace_back("Out");
 }
 
-const NodeRef* EntryNode::Process(ScriptInstance& state)
+const NodeRef* EntryNode::Process(ScriptInstance& state) const
 {
 	return &OutputNodeRefs[0];
 }
@@ -149,7 +219,7 @@ Condition::Condition()
 	Arguments.emplace_back(ValueTypes::Boolean, "Condition");
 }
 
-const NodeRef* Condition::Process(ScriptInstance& state)
+const NodeRef* Condition::Process(ScriptInstance& state) const
 {
 	const auto* val = state.GetValue(Arguments[0]);
 	if (val == nullptr)
@@ -161,8 +231,22 @@ const NodeRef* Condition::Process(ScriptInstance& state)
 		return &OutputNodeRefs[1];
 }
 
+Delay::Delay()
+{
+	OutputNodeRefs.emplace_back("Out");
+
+	Arguments.emplace_back(ValueTypes::Number, "Seconds");
+}
+
+const NodeRef* Delay::Process(ScriptInstance& state) const
+{
+	auto* seconds = state.GetValue(Arguments[0]);
+
+	state.Suspend(seconds ? seconds->Number() : 0.0f);
+	return &OutputNodeRefs[0];
+}
+
 Loop::Loop()
-	: IndexValue(0)
 {
 	OutputNodeRefs.emplace_back("Complete");
 	OutputNodeRefs.emplace_back("Cycle");
@@ -172,16 +256,9 @@ Loop::Loop()
 	Values.emplace_back(ValueTypes::Number, "Index", 0);
 }
 
-const NodeRef* Loop::Process(ScriptInstance& state)
+const NodeRef* Loop::Process(ScriptInstance& state) const
 {
-	auto indexItr = state.NodeStateNums.find(ID);
-
-	uint32_t index = 0;
-	if (indexItr != state.NodeStateNums.end())
-		index = indexItr->second + 1;
-
-	state.NodeStateNums[ID] = index;
-
+	uint32_t index = uint32_t(++state.GetLoopIndex(*this));
 	if (Itterations > 0 && index >= Itterations)
 		return &OutputNodeRefs[0];
 
@@ -193,16 +270,13 @@ const NodeRef* Loop::Process(ScriptInstance& state)
 	return &OutputNodeRefs[1];
 }
 
-const ValueData* Loop::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* Loop::GetValue(uint32_t id, ScriptInstance& state) const
 {
-	auto indexItr = state.NodeStateNums.find(ID);
-
-	if (indexItr != state.NodeStateNums.end())
-		IndexValue.Value = float(indexItr->second);
-	else
-		IndexValue.Value = 0;
+	ValueData& result = state.GetNodeValue(*this, id);
+	int32_t index = state.GetLoopIndex(*this);
+	result.SetNumber(index > 0 ? float(index) : 0.0f);
 
-	return &IndexValue;
+	return &result;
 }
 
 void Loop::Read(void* data, size_t size, size_t& offset)
@@ -225,7 +299,6 @@ bool Loop::Write(void* data, size_t& offset)
 
 BooleanComparison::BooleanComparison(Operation op)
 	: Operator(op)
-	, ReturnValue(false)
 {
 	AllowInput = false;
 
@@ -235,20 +308,16 @@ BooleanComparison::BooleanComparison(Operation op)
 	Values.emplace_back(ValueTypes::Boolean, "Result", 0);
 }
 
-const ValueData* BooleanComparison::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* BooleanComparison::GetValue(uint32_t id, ScriptInstance& state) const
 {
+	ValueData& result = state.GetNodeValue(*this, id);
 	auto* a = state.GetValue(Arguments[0]);
 	auto* b = state.GetValue(Arguments[1]);
 
 	if (a && b)
-	{
-		if (Operator == Operation::AND)
-			ReturnValue.Value = a->Boolean() && b->Boolean();
-		else
-			ReturnValue.Value = a->Boolean() || b->Boolean();
-	}
+		result.SetBool(Evaluate(Operator, a->Boolean(), b->Boolean()));
 
-	return &ReturnValue;
+	return &result;
 }
 
 void BooleanComparison::Read(void* data, size_t size, size_t& offset)
@@ -270,7 +339,6 @@ bool BooleanComparison::Write(void* data, size_t& offset)
 }
 
 NotComparison::NotComparison()
-	: ReturnValue(false)
 {
 	AllowInput = false;
 
@@ -279,17 +347,17 @@ NotComparison::NotComparison()
 	Values.emplace_back(ValueTypes::Boolean, "Result", 0);
 }
 
-const ValueData* NotComparison::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* NotComparison::GetValue(uint32_t id, ScriptInstance& state) const
 {
+	ValueData& result = state.GetNodeValue(*this, id);
 	auto* in = state.GetValue(Arguments[0]);
 
-	ReturnValue.Value = in && !in->Boolean();
-	return &ReturnValue;
+	result.SetBool(in && !in->Boolean());
+	return &result;
 }
 
 NumberComparison::NumberComparison(Operation op) 
 	: Operator(op)
-	, ReturnValue(false)
 {
 	AllowInput = false;
 
@@ -299,39 +367,18 @@ NumberComparison::NumberComparison(Operation op)
 	Values.emplace_back(ValueTypes::Boolean, "Result", 0);
 }
 
-const ValueData* NumberComparison::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* NumberComparison::GetValue(uint32_t id, ScriptInstance& state) const
 {
+	ValueData& result = state.GetNodeValue(*this, id);
 	auto* a = state.GetValue(Arguments[0]);
 	auto* b = state.GetValue(Arguments[1]);
 
-	ReturnValue.Value = false;
+	result.SetBool(false);
 
 	if (a && b)
-	{
-		switch (Operator)
-		{
-			case NumberComparison::Operation::GreaterThan:
-				ReturnValue.Value = a->Number() > b->Number();
-				break;
-			case NumberComparison::Operation::GreaterThanEqual:
-				ReturnValue.Value = a->Number() >= b->Number();
-				break;
-			case NumberComparison::Operation::LessThan:
-				ReturnValue.Value = a->Number() < b->Number();
-				break;
-			case NumberComparison::Operation::LessThanEqual:
-				ReturnValue.Value = a->Number() <= b->Number();
-				break;
-			case NumberComparison::Operation::Equal:
-				ReturnValue.Value = a->Number() == b->Number();
-				break;
-			case NumberComparison::Operation::NotEqual:
-				ReturnValue.Value = a->Number() != b->Number();
-				break;
-		}
-	}
+		result.SetBool(Evaluate(Operator, a->Number(), b->Number()));
 
-	return &ReturnValue;
+	return &result;
 }
 
 void NumberComparison::Read(void* data, size_t size, size_t& offset)
@@ -354,7 +401,6 @@ bool NumberComparison::Write(void* data, size_t& offset)
 
 Math::Math(Operation op)
 	: Operator(op)
-	, ReturnValue(0)
 {
 	AllowInput = false;
 
@@ -364,39 +410,18 @@ Math::Math(Operation op)
 	Values.emplace_back(ValueTypes::Number, "Result", 0);
 }
 
-const ValueData* Math::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* Math::GetValue(uint32_t id, ScriptInstance& state) const
 {
+	ValueData& result = state.GetNodeValue(*this, id);
 	auto* a = state.GetValue(Arguments[0]);
 	auto* b = state.GetValue(Arguments[1]);
 
-	ReturnValue.Value = 0;
+	result.SetNumber(0);
 
 	if (a && b)
-	{
-		switch (Operator)
-		{
-			case Math::Operation::Add:
-				ReturnValue.Value = a->Number() + b->Number();
-				break;
-			case Math::Operation::Subtract:
-				ReturnValue.Value = a->Number() - b->Number();
-				break;
-			case Math::Operation::Multiply:
-				ReturnValue.Value = a->Number() * b->Number();
-				break;
-			case Math::Operation::Divide:
-				ReturnValue.Value = a->Number() / b->Number();
-				break;
-			case Math::Operation::Modulo:
-				ReturnValue.Value = float(int(a->Number()) % int(b->Number()));
-				break;
-			case Math::Operation::Pow:
-				ReturnValue.Value = powf(a->Number(), b->Number());
-				break;
-		}
-	}
+		result.SetNumber(Evaluate(Operator, a->Number(), b->Number()));
 
-	return &ReturnValue;
+	return &result;
 }
 
 void Math::Read(void* data, size_t size, size_t& offset)
@@ -424,7 +449,7 @@ BooleanLiteral::BooleanLiteral(bool value)
 	Values.emplace_back(ValueTypes::Boolean, "", 0);
 }
 
-const ValueData* BooleanLiteral::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* BooleanLiteral::GetValue(uint32_t id, ScriptInstance& state) const
 {
 	return &ReturnValue;
 }
@@ -432,7 +457,7 @@ const ValueData* BooleanLiteral::GetValue(uint32_t id, ScriptInstance& state)
 void BooleanLiteral::Read(void* data, size_t size, size_t& offset)
 {
 	Node::Read(data, size, offset);
-	ReturnValue.Value = ReadBool(data, size, offset);
+	ReturnValue.SetBool(ReadBool(data, size, offset));
 }
 
 size_t BooleanLiteral::GetDataSize()
@@ -443,7 +468,7 @@ size_t BooleanLiteral::GetDataSize()
 bool BooleanLiteral::Write(void* data, size_t& offset)
 {
 	Node::Write(data, offset);
-	WriteBool(ReturnValue.Value, data, offset);
+	WriteBool(ReturnValue.BoolValue, data, offset);
 	return true;
 }
 
@@ -454,7 +479,7 @@ NumberLiteral::NumberLiteral(float value)
 	Values.emplace_back(ValueTypes::Number, "", 0);
 }
 
-const ValueData* NumberLiteral::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* NumberLiteral::GetValue(uint32_t id, ScriptInstance& state) const
 {
 	return &ReturnValue;
 }
@@ -462,7 +487,7 @@ const ValueData* NumberLiteral::GetValue(uint32_t id, ScriptInstance& state)
 void NumberLiteral::Read(void* data, size_t size, size_t& offset)
 {
 	Node::Read(data, size, offset);
-	ReturnValue.Value = ReadFloat(data, size, offset);
+	ReturnValue.SetNumber(ReadFloat(data, size, offset));
 }
 
 size_t NumberLiteral::GetDataSize()
@@ -473,7 +498,7 @@ size_t NumberLiteral::GetDataSize()
 bool NumberLiteral::Write(void* data, size_t& offset)
 {
 	Node::Write(data, offset);
-	WriteFloat(ReturnValue.Value, data, offset);
+	WriteFloat(ReturnValue.NumberValue, data, offset);
 	return true;
 }
 
@@ -484,7 +509,7 @@ StringLiteral::StringLiteral(const std::string& value)
 	Values.emplace_back(ValueTypes::String, "", 0);
 }
 
-const ValueData* StringLiteral::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* StringLiteral::GetValue(uint32_t id, ScriptInstance& state) const
 {
 	return &ReturnValue;
 }
@@ -492,18 +517,18 @@ const ValueData* StringLiteral::GetValue(uint32_t id, ScriptInstance& state)
 void StringLiteral::Read(void* data, size_t size, size_t& offset)
 {
 	Node::Read(data, size, offset);
-	ReturnValue.Value = ReadString(data, size, offset);
+	ReturnValue.SetString(ReadString(data, size, offset));
 }
 
 size_t StringLiteral::GetDataSize()
 {
-	return Node::GetDataSize() + GetStringDataSize(ReturnValue.Value);
+	return Node::GetDataSize() + GetStringDataSize(*ReturnValue.StringValue);
 }
 
 bool StringLiteral::Write(void* data, size_t& offset)
 {
 	Node::Write(data, offset);
-	WriteString(ReturnValue.Value, data, offset);
+	WriteString(*ReturnValue.StringValue, data, offset);
 	return true;
 }
 
@@ -514,21 +539,21 @@ PrintLog::PrintLog()
 	Arguments.emplace_back(ValueTypes::String, "Text");
 }
 
-const NodeRef* PrintLog::Process(ScriptInstance& state)
+const NodeRef* PrintLog::Process(ScriptInstance& state) const
 {
 	auto* text = state.GetValue(Arguments[0]);
 
+	std::string scratch;
 	if (text)
-		LogFunction(text->String());
+		LogFunction(text->String(scratch));
 
 	return &OutputNodeRefs[0];
 }
 
-std::function<void(const std::string&)> PrintLog::LogFunction = [](const std::string& text) { printf("%s", text.c_str()); };
+std::function<void(const std::string&)> PrintLog::LogFunction = [](const std::string& text) { fputs(text.c_str(), stdout); };
 
 
 LoadBool::LoadBool()
-	: ReturnValue(false)
 {
 	AllowInput = false;
 	Arguments.emplace_back(ValueTypes::String, "VariableName");
@@ -536,14 +561,16 @@ LoadBool::LoadBool()
 	Values.emplace_back(ValueTypes::Boolean, "Value", 0);
 }
 
-const ValueData* LoadBool::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* LoadBool::GetValue(uint32_t id, ScriptInstance& state) const
 {
+	ValueData& result = state.GetNodeValue(*this, id);
 	auto* name = state.GetValue(Arguments[0]);
 
+	std::string scratch;
 	if (name)
-		ReturnValue.Value = state.BoolGlobals[name->String()];
+		result.SetBool(state.GetBool(name->String(scratch)));
 
-	return &ReturnValue;
+	return &result;
 }
 
 SaveBool::SaveBool()
@@ -554,19 +581,19 @@ SaveBool::SaveBool()
 	Arguments.emplace_back(ValueTypes::Boolean, "Value");
 }
 
-const NodeRef* SaveBool::Process(ScriptInstance& state)
+const NodeRef* SaveBool::Process(ScriptInstance& state) const
 {
 	auto* name = state.GetValue(Arguments[0]);
 	auto* value = state.GetValue(Arguments[1]);
 
-	if (name)
-		state.BoolGlobals[name->String()] = value->Boolean();
+	std::string scratch;
+	if (name && value)
+		state.SetBool(name->String(scratch), value->Boolean());
 
 	return &OutputNodeRefs[0];
 }
 
 LoadNumber::LoadNumber()
-	: ReturnValue(0)
 {
 	AllowInput = false;
 	Arguments.emplace_back(ValueTypes::String, "VariableName");
@@ -574,14 +601,16 @@ LoadNumber::LoadNumber()
 	Values.emplace_back(ValueTypes::Number, "Value", 0);
 }
 
-const ValueData* LoadNumber::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* LoadNumber::GetValue(uint32_t id, ScriptInstance& state) const
 {
+	ValueData& result = state.GetNodeValue(*this, id);
 	auto* name = state.GetValue(Arguments[0]);
 
+	std::string scratch;
 	if (name)
-		ReturnValue.Value = state.NumGlobals[name->String()];
+		result.SetNumber(state.GetNumber(name->String(scratch)));
 
-	return &ReturnValue;
+	return &result;
 }
 
 SaveNumber::SaveNumber()
@@ -592,19 +621,19 @@ SaveNumber::SaveNumber()
 	Arguments.emplace_back(ValueTypes::Number, "Value");
 }
 
-const NodeRef* SaveNumber::Process(ScriptInstance& state)
+const NodeRef* SaveNumber::Process(ScriptInstance& state) const
 {
 	auto* name = state.GetValue(Arguments[0]);
 	auto* value = state.GetValue(Arguments[1]);
 
-	if (name)
-		state.NumGlobals[name->String()] = value->Number();
+	std::string scratch;
+	if (name && value)
+		state.SetNumber(name->String(scratch), value->Number());
 
 	return &OutputNodeRefs[0];
 }
 
 LoadString::LoadString()
-	: ReturnValue("")
 {
 	AllowInput = false;
 	Arguments.emplace_back(ValueTypes::String, "VariableName");
@@ -612,14 +641,16 @@ LoadString::LoadString()
 	Values.emplace_back(ValueTypes::String, "Value", 0);
 }
 
-const ValueData* LoadString::GetValue(uint32_t id, ScriptInstance& state)
+const ValueData* LoadString::GetValue(uint32_t id, ScriptInstance& state) const
 {
+	ValueData& result = state.GetNodeValue(*this, id);
 	auto* name = state.GetValue(Arguments[0]);
 
+	std::string scratch;
 	if (name)
-		ReturnValue.Value = state.StringGlobals[name->String()];
+		state.SetValueString(result, state.GetString(name->String(scratch)));
 
-	return &ReturnValue;
+	return &result;
 }
 
 SaveString::SaveString()
@@ -627,16 +658,20 @@ SaveString::SaveString()
 	OutputNodeRefs.emplace_back("Out");
 
 	Arguments.emplace_back(ValueTypes::String, "VariableName");
-	Arguments.emplace_back(ValueTypes::Number, "Value");
+	// this was declared as a number pin before type inference, which would now convert every saved string to a number.
+	// pins are not stored in .script files, so older files pick up the string pin when they load
+	Arguments.emplace_back(ValueTypes::String, "Value");
 }
 
-const NodeRef* SaveString::Process(ScriptInstance& state)
+const NodeRef* SaveString::Process(ScriptInstance& state) const
 {
 	auto* name = state.GetValue(Arguments[0]);
 	auto* value = state.GetValue(Arguments[1]);
 
-	if (name)
-		state.StringGlobals[name->String()] = value->String();
+	std::string nameText;
+	std::string valueText;
+	if (name && value)
+		state.SetString(name->String(nameText), value->String(valueText));
 
 	return &OutputNodeRefs[0];
 }
@@ -660,8 +695,9 @@ void ScriptGraph::Write(ScriptResource& resource) const
 			nameLen = NodeResource::MaxNodeName-1;
 		memcpy(res.Name, node->Name.c_str(), nameLen);
 
+		// zeroed, GetDataSize counts a values count that Write leaves out, so the buffer ends in padding
 		res.DataSize = node->GetDataSize();
-		res.Data = malloc(res.DataSize);
+		res.Data = calloc(1, res.DataSize);
 		size_t offset = 0;
 		if (node->Write(res.Data, offset))
 			resource.Nodes.emplace_back(std::move(res));
@@ -677,31 +713,164 @@ bool ScriptGraph::Read(const ScriptResource& package)
 
 	for (const NodeResource& res : package.Nodes)
 	{
-		Nodes[res.ID] = NodeRegistry::LoadNode(res.TypeName, res.Data, res.DataSize);
-		Nodes[res.ID]->ID = res.ID;
-		Nodes[res.ID]->Name = res.Name;
+		Node* node = NodeRegistry::LoadNode(res.TypeName, res.Data, res.DataSize);
+		if (!node)
+			continue;
+
+		Nodes[res.ID] = node;
+		node->ID = res.ID;
+		node->Name = res.Name;
 
 		if (res.EntryPoint)
 		{
-			EntryNodes.insert_or_assign(Nodes[res.ID]->Name, Nodes[res.ID]);
+			EntryNodes.insert_or_assign(node->Name, node);
 		}
 	}
+
+	Compile();
 	return true;
 }
 
 uint32_t ScriptGraph::AddNode(Node* node)
 {
-	uint32_t id = 0;
-	for (const auto& [i,n] : Nodes)
-	{
-		if (id <= n->ID)
-			id = n->ID;
-	}
-
-	id++;
+	// the map is ordered, so the highest ID is always the last one
+	uint32_t id = Nodes.empty() ? 1 : Nodes.rbegin()->first + 1;
 
 	node->ID = id;
+	node->Index = uint32_t(NodeTable.size());
 	Nodes[id] = node;
+	NodeTable.push_back(node);
+
+	Program.reset();
 
 	return id;
-}
\ No newline at end of file
+}
+
+Node* ScriptGraph::FindNode(uint32_t id) const
+{
+	auto itr = Nodes.find(id);
+	if (itr == Nodes.end())
+		return nullptr;
+
+	return itr->second;
+}
+
+bool ScriptGraph::Verify()
+{
+	ResolveNodeRefs();
+	VerifyErrors.clear();
+
+	auto error = [this](const Node* node, const std::string& text)
+	{
+		VerifyErrors.push_back("node " + std::to_string(node->ID) + " (" + node->TypeName() + ") " + text);
+	};
+
+	for (const Node* node : NodeTable)
+	{
+		if (!node->LoadError.empty())
+			error(node, node->LoadError);
+
+		for (size_t i = 0; i < node->OutputNodeRefs.size(); i++)
+		{
+			const NodeRef& ref = node->OutputNodeRefs[i];
+			if (ref.ID != uint32_t(-1) && ref.Index == uint32_t(-1))
+				error(node, "output " + std::to_string(i) + " goes to missing node " + std::to_string(ref.ID));
+		}
+
+		for (size_t i = 0; i < node->Arguments.size(); i++)
+		{
+			const ValueRef& ref = node->Arguments[i];
+			if (ref.ID == uint32_t(-1))
+				continue;
+
+			if (ref.Index == uint32_t(-1))
+			{
+				error(node, "argument " + std::to_string(i) + " reads missing node " + std::to_string(ref.ID));
+				continue;
+			}
+
+			// ResolveNodeRefs already gave refs without a value ID the node's first value
+			const Node* source = NodeTable[ref.Index];
+			if (source->Values.empty())
+				error(node, "argument " + std::to_string(i) + " reads node " + std::to_string(ref.ID) + ", which has no values");
+			else if (ref.ValueId >= source->Values.size())
+				error(node, "argument " + std::to_string(i) + " reads value " + std::to_string(ref.ValueId) + " of node " + std::to_string(ref.ID) + ", which has " + std::to_string(source->Values.size()));
+		}
+	}
+
+	// depth first walk over the values each value reads, a node seen again while still open is a cycle
+	enum : uint8_t { Unvisited, Open, Done };
+	std::vector<uint8_t> state(NodeTable.size(), Unvisited);
+	std::vector<std::pair<uint32_t, uint32_t>> stack;
+
+	for (uint32_t start = 0; start < NodeTable.size(); start++)
+	{
+		if (state[start] != Unvisited || !NodeTable[start]->ValuesUseArguments())
+			continue;
+
+		state[start] = Open;
+		stack.emplace_back(start, 0);
+
+		while (!stack.empty())
+		{
+			auto& [index, argument] = stack.back();
+			const Node* node = NodeTable[index];
+			if (argument == node->Arguments.size())
+			{
+				state[index] = Done;
+				stack.pop_back();
+				continue;
+			}
+
+			uint32_t next = node->Arguments[argument++].Index;
+			if (next >= NodeTable.size() || !NodeTable[next]->ValuesUseArguments() || state[next] == Done)
+				continue;
+
+			if (state[next] == Open)
+			{
+				error(NodeTable[next], "has a value that depends on itself");
+				continue;
+			}
+
+			state[next] = Open;
+			stack.emplace_back(next, 0);
+		}
+	}
+
+	return VerifyErrors.empty();
+}
+
+void ScriptGraph::ResolveNodeRefs()
+{
+	NodeTable.clear();
+	NodeTable.reserve(Nodes.size());
+
+	for (auto& [id, node] : Nodes)
+	{
+		if (!node)
+			continue;
+
+		node->ID = id;
+		node->Index = uint32_t(NodeTable.size());
+		NodeTable.push_back(node);
+	}
+
+	for (Node* node : NodeTable)
+	{
+		for (NodeRef& ref : node->OutputNodeRefs)
+		{
+			Node* target = FindNode(ref.ID);
+			ref.Index = target ? target->Index : uint32_t(-1);
+		}
+
+		for (ValueRef& ref : node->Arguments)
+		{
+			Node* target = FindNode(ref.ID);
+			ref.Index = target ? target->Index : uint32_t(-1);
+
+			// value IDs are not saved, refs loaded from a file or made in the editor read the first value
+			if (target && ref.ValueId == uint32_t(-1))
+				ref.ValueId = 0;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#include "script_instrumentation.h"
+
+#include <algorithm>
+
+void ScriptCounters::Reset()
+{
+	Instructions.clear();
+	ValueReads = 0;
+	GlobalWrites = 0;
+}
+
+std::string ScriptCounters::GetReport(const ScriptProgram& program) const
+{
+	// superinstructions and their plain forms share a node, so add them up per node
+	std::map<uint32_t, uint64_t> nodes;
+	for (size_t pc = 0; pc < Instructions.size() && pc < program.Code.size(); pc++)
+	{
+		if (Instructions[pc] > 0)
+			nodes[program.Code[pc].NodeId] += Instructions[pc];
+	}
+
+	std::vector<std::pair<uint32_t, uint64_t>> sorted(nodes.begin(), nodes.end());
+	std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+	std::string report;
+	for (const auto& [nodeId, count] : sorted)
+		report += "node " + std::to_string(nodeId) + " x" + std::to_string(count) + "\n";
+
+	report += "value reads " + std::to_string(ValueReads) + ", global writes " + std::to_string(GlobalWrites) + "\n";
+	return report;
+}
+
+bool ScriptDebugger::EnterNode(ScriptInstance& instance, uint32_t pc)
+{
+	// carrying on from the node it stopped at
+	if (pc == ResumePc)
+	{
+		ResumePc = uint32_t(-1);
+		BreakNode = uint32_t(-1);
+		return true;
+	}
+
+	uint32_t nodeId = instance.GetProgram()->Code[pc].NodeId;
+	if (!SingleStep && Breakpoints.find(nodeId) == Breakpoints.end())
+		return true;
+
+	ResumePc = pc;
+	BreakNode = nodeId;
+	if (OnBreak)
+		OnBreak(instance, nodeId);
+
+	return false;
+}
+
+void ScriptDebugger::WriteGlobal(ScriptInstance& instance, uint32_t pc)
+{
+	if (OnGlobalWrite)
+		OnGlobalWrite(instance, instance.GetProgram()->Code[pc].NodeId);
+}
@@ -0,0 +1,768 @@
+#include "script_jit.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#ifdef SCRIPT_GRAPH_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool ScriptJit::WritePerfMap = true;
+
+namespace
+{
+	// registers the generated code keeps for the whole run
+	constexpr uint32_t RAX = 0;
+	constexpr uint32_t RSP = 4;
+	constexpr uint32_t RDI = 7;
+	constexpr uint32_t SlotBase = 3;		// rbx
+	constexpr uint32_t BoolBase = 13;		// r13
+	constexpr uint32_t NumberBase = 14;		// r14
+	constexpr uint32_t StringBase = 15;		// r15
+
+	// condition codes for jcc and setcc
+	constexpr uint8_t AboveEqual = 0x3;
+	constexpr uint8_t Equal = 0x4;
+	constexpr uint8_t NotEqual = 0x5;
+
+	static_assert(sizeof(ValueTypes) == 4, "the tag template writes a 32 bit type");
+}
+
+ScriptJit::~ScriptJit()
+{
+#ifdef SCRIPT_GRAPH_JIT
+	if (CodeMemory)
+		munmap(CodeMemory, MappedSize);
+#endif
+}
+
+bool ScriptJit::IsAvailable()
+{
+#ifdef SCRIPT_GRAPH_JIT
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool ScriptJit::Compile(const ScriptProgram& program)
+{
+#ifdef SCRIPT_GRAPH_JIT
+	Program = &program;
+	Code.clear();
+	Symbols.clear();
+	Skipped.clear();
+
+	// every slot has to be reachable with a 32 bit displacement
+	if (program.Slots.size() >= size_t(INT32_MAX) / sizeof(ValueData))
+	{
+		Program = nullptr;
+		return false;
+	}
+
+	std::vector<size_t> offsets(program.EntryTable.size(), size_t(-1));
+	for (const auto& [name, handle] : program.EntryPoints)
+	{
+		uint32_t entryPc = program.GetEntryPoint(handle);
+		if (entryPc == ScriptProgram::InvalidTarget)
+			continue;
+
+		size_t codeStart = Code.size();
+		size_t symbolStart = Symbols.size();
+		if (!EmitEntry(entryPc, name))
+		{
+			Code.resize(codeStart);
+			Symbols.resize(symbolStart);
+			Skipped.push_back(name + ": " + Error);
+			continue;
+		}
+
+		offsets[handle] = codeStart;
+	}
+
+	Program = nullptr;
+	if (Code.empty())
+		return false;
+
+	long pageSize = sysconf(_SC_PAGESIZE);
+	MappedSize = (Code.size() + pageSize - 1) / pageSize * pageSize;
+
+	void* memory = mmap(nullptr, MappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED)
+		return false;
+
+	// never writable and executable at the same time
+	memcpy(memory, Code.data(), Code.size());
+	if (mprotect(memory, MappedSize, PROT_READ | PROT_EXEC) != 0)
+	{
+		munmap(memory, MappedSize);
+		return false;
+	}
+
+	CodeMemory = memory;
+	CodeSize = Code.size();
+
+	Entries.assign(offsets.size(), nullptr);
+	for (size_t i = 0; i < offsets.size(); i++)
+	{
+		if (offsets[i] != size_t(-1))
+			Entries[i] = EntryFunction((uint8_t*)CodeMemory + offsets[i]);
+	}
+
+	if (WritePerfMap)
+	{
+		char path[64] = { 0 };
+		snprintf(path, sizeof(path), "/tmp/perf-%d.map", int(getpid()));
+
+		FILE* fp = fopen(path, "a");
+		if (fp)
+		{
+			for (const Symbol& symbol : Symbols)
+				fprintf(fp, "%llx %zx %s\n", (unsigned long long)((uint8_t*)CodeMemory + symbol.Offset), symbol.Size, symbol.Name.c_str());
+			fclose(fp);
+		}
+	}
+
+	Code.clear();
+	Code.shrink_to_fit();
+	return true;
+#else
+	(void)program;
+	return false;
+#endif
+}
+
+bool ScriptJit::IsSlot(uint32_t slot, ValueTypes type) const
+{
+	return Program->HasFixedType(slot) && Program->Slots[slot].Type == type;
+}
+
+bool ScriptJit::EmitEntry(uint32_t entryPc, const std::string& name)
+{
+	Contexts.assign(1, Context());
+	Blocks.clear();
+	BlockIndexes.clear();
+	Fixups.clear();
+	ReturnFixups.clear();
+	LoopStates.clear();
+	Error.clear();
+
+	size_t start = Code.size();
+
+	// keep the slots, the instance and the global arrays in callee saved registers
+	Bytes({ 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57 });
+	Bytes({ 0x49, 0x89, 0xFC });	// mov r12, rdi
+	Bytes({ 0x48, 0x89, 0xF3 });	// mov rbx, rsi
+	Bytes({ 0x49, 0x89, 0xD5 });	// mov r13, rdx
+	Bytes({ 0x49, 0x89, 0xCE });	// mov r14, rcx
+	Bytes({ 0x4D, 0x89, 0xC7 });	// mov r15, r8
+
+	// the loop indexes live on the stack, how many is only known once every block is written
+	Bytes({ 0x48, 0x81, 0xEC });
+	size_t frameSize = Code.size();
+	UInt(0);
+
+	Byte(0xE9);
+	size_t initJump = Code.size();
+	UInt(0);
+
+	Symbols.push_back({ start, Code.size() - start, "script:" + name });
+
+	uint32_t first = Target(entryPc, 0);
+	for (uint32_t i = 0; i < uint32_t(Blocks.size()); i++)
+	{
+		if (!EmitBlock(i, name))
+			return false;
+	}
+
+	uint32_t frame = (uint32_t(LoopStates.size()) * 4 + 15) & ~15u;
+	memcpy(&Code[frameSize], &frame, 4);
+
+	size_t tail = Code.size();
+
+	size_t epilogue = Code.size();
+	Bytes({ 0x48, 0x81, 0xC4 });
+	UInt(frame);
+	Bytes({ 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3 });
+
+	// loop indexes start out unset, the first pass through a loop makes them 0
+	int32_t init = int32_t(Code.size() - (initJump + 4));
+	memcpy(&Code[initJump], &init, 4);
+	for (const auto& [nodeId, state] : LoopStates)
+	{
+		Op({}, { 0xC7 }, false, 0, RSP, int32_t(state * 4));
+		UInt(uint32_t(-1));
+	}
+	JumpTo(first);
+
+	Symbols.push_back({ tail, Code.size() - tail, "script:" + name });
+
+	for (const Fixup& fixup : Fixups)
+	{
+		int32_t rel = int32_t(Blocks[fixup.Block].Offset - (fixup.Offset + 4));
+		memcpy(&Code[fixup.Offset], &rel, 4);
+	}
+
+	for (size_t offset : ReturnFixups)
+	{
+		int32_t rel = int32_t(epilogue - (offset + 4));
+		memcpy(&Code[offset], &rel, 4);
+	}
+
+	return true;
+}
+
+bool ScriptJit::EmitBlock(uint32_t blockIndex, const std::string& name)
+{
+	Blocks[blockIndex].Offset = Code.size();
+
+	uint32_t pc = Blocks[blockIndex].Pc;
+	uint32_t context = Blocks[blockIndex].Context;
+	const Instruction ins = ScriptProgram::Unfuse(Program->Code[pc]);
+
+	switch (ins.Op)
+	{
+		case OpCode::Delay:
+			Error = "delay nodes suspend the instance, which only the interpreter can do";
+			return false;
+
+		case OpCode::Native:
+			Error = std::string("node type ") + ins.Source->TypeName() + " has no template";
+			return false;
+
+		default:
+			break;
+	}
+
+	// loops evaluate their condition once the index has moved
+	if (ins.Op != OpCode::Loop && !EmitValues(ins.ValueBegin, ins.ValueEnd))
+		return false;
+
+	bool hasArg0 = ins.Args[0] != ScriptProgram::InvalidSlot;
+	bool hasArg1 = ins.Args[1] != ScriptProgram::InvalidSlot;
+
+	switch (ins.Op)
+	{
+		case OpCode::Entry:
+		case OpCode::Jump:
+			break;
+
+		case OpCode::Condition:
+			if (!hasArg0)
+			{
+				JumpTo(Target(ScriptProgram::InvalidTarget, context));
+				break;
+			}
+
+			LoadBoolean(ins.Args[0]);
+			JumpIf(NotEqual, Target(ins.Next[0], context));
+			JumpTo(Target(ins.Next[1], context));
+			break;
+
+		case OpCode::Loop:
+		{
+			uint32_t body = EnterLoop(pc, context);
+			if (body == uint32_t(-1))
+				return false;
+
+			// unset is -1, so the next index is always one more
+			int32_t state = int32_t(LoopState(ins.NodeId) * 4);
+			Op({}, { 0x8B }, false, RAX, RSP, state);
+			Bytes({ 0xFF, 0xC0 });	// inc eax
+			Op({}, { 0x89 }, false, RAX, RSP, state);
+
+			if (ins.Operand > 0)
+			{
+				Byte(0x3D);		// cmp eax, imm32
+				UInt(ins.Operand);
+				JumpIf(AboveEqual, Target(ins.Next[0], context));
+			}
+
+			if (!EmitValues(ins.ValueBegin, ins.ValueEnd))
+				return false;
+
+			if (hasArg0)
+			{
+				LoadBoolean(ins.Args[0]);
+				JumpIf(Equal, Target(ins.Next[0], context));
+			}
+
+			JumpTo(Target(ins.Next[1], body));
+			break;
+		}
+
+		case OpCode::SaveBoolGlobal:
+			if (hasArg1 && IsSlot(ins.Args[1], ValueTypes::Boolean))
+			{
+				Op({}, { 0x0F, 0xB6 }, false, RAX, SlotBase, SlotValue(ins.Args[1]));		// movzx eax, byte
+				Op({}, { 0x88 }, false, RAX, BoolBase, int32_t(ins.Operand));
+			}
+			else if (hasArg1)
+			{
+				Bytes({ 0x4C, 0x89, 0xE7 });	// mov rdi, r12
+				Byte(0xBE);						// mov esi, imm32
+				UInt(pc);
+				Call((const void*)&ScriptJit::CallInstruction);
+			}
+			break;
+
+		case OpCode::SaveNumberGlobal:
+			if (hasArg1 && IsSlot(ins.Args[1], ValueTypes::Number))
+			{
+				Op({ 0xF3 }, { 0x0F, 0x10 }, false, 0, SlotBase, SlotValue(ins.Args[1]));		// movss xmm0
+				Op({ 0xF3 }, { 0x0F, 0x11 }, false, 0, NumberBase, int32_t(ins.Operand * 4));
+			}
+			else if (hasArg1)
+			{
+				Bytes({ 0x4C, 0x89, 0xE7 });
+				Byte(0xBE);
+				UInt(pc);
+				Call((const void*)&ScriptJit::CallInstruction);
+			}
+			break;
+
+		case OpCode::SaveStringGlobal:
+			// only literals can be shared, any other text is copied into the instance by the helper
+			if (hasArg1 && IsSlot(ins.Args[1], ValueTypes::String) && Program->IsConstant(ins.Args[1]))
+			{
+				Op({}, { 0x8B }, true, RAX, SlotBase, SlotValue(ins.Args[1]));
+				Op({}, { 0x89 }, true, RAX, StringBase, int32_t(ins.Operand * 8));
+			}
+			else if (hasArg1)
+			{
+				Bytes({ 0x4C, 0x89, 0xE7 });
+				Byte(0xBE);
+				UInt(pc);
+				Call((const void*)&ScriptJit::CallInstruction);
+			}
+			break;
+
+		default:
+			// logging and name based globals go through the same calls the interpreter makes
+			if (hasArg0 && (ins.Op == OpCode::PrintLog || hasArg1))
+			{
+				Bytes({ 0x4C, 0x89, 0xE7 });
+				Byte(0xBE);
+				UInt(pc);
+				Call((const void*)&ScriptJit::CallInstruction);
+			}
+			break;
+	}
+
+	if (ins.Op != OpCode::Condition && ins.Op != OpCode::Loop)
+		JumpTo(Target(ins.Next[0], context));
+
+	const char* typeName = ins.Source ? ins.Source->TypeName() : "Jump";
+	size_t offset = Blocks[blockIndex].Offset;
+	Symbols.push_back({ offset, Code.size() - offset, "script:" + name + ":" + typeName + "#" + std::to_string(ins.NodeId) });
+	return true;
+}
+
+bool ScriptJit::EmitValues(uint32_t begin, uint32_t end)
+{
+	for (uint32_t i = begin; i < end; i++)
+	{
+		if (!EmitValue(i))
+			return false;
+	}
+
+	return true;
+}
+
+bool ScriptJit::EmitValue(uint32_t index)
+{
+	const ValueOp& op = Program->ValueCode[index];
+
+	bool numbers = IsSlot(op.A, ValueTypes::Number) && IsSlot(op.B, ValueTypes::Number);
+	bool bools = IsSlot(op.A, ValueTypes::Boolean) && IsSlot(op.B, ValueTypes::Boolean);
+	int32_t dest = SlotValue(op.Dest);
+
+	switch (op.Op)
+	{
+		case ValueOpCode::Math:
+		{
+			uint8_t opcode = 0;
+			switch (Math::Operation(op.Operator))
+			{
+				case Math::Operation::Add:
+					opcode = 0x58;
+					break;
+				case Math::Operation::Subtract:
+					opcode = 0x5C;
+					break;
+				case Math::Operation::Multiply:
+					opcode = 0x59;
+					break;
+				case Math::Operation::Divide:
+					opcode = 0x5E;
+					break;
+				default:
+					break;
+			}
+
+			if (!numbers || opcode == 0)
+				break;
+
+			Op({ 0xF3 }, { 0x0F, 0x10 }, false, 0, SlotBase, SlotValue(op.A));
+			Op({ 0xF3 }, { 0x0F, opcode }, false, 0, SlotBase, SlotValue(op.B));
+			Op({ 0xF3 }, { 0x0F, 0x11 }, false, 0, SlotBase, dest);
+			StoreTag(op.Dest, ValueTypes::Number);
+			return true;
+		}
+
+		case ValueOpCode::NumberComparison:
+		{
+			if (!numbers || op.Operator >= uint8_t(NumberComparison::Operation::LAST_OP))
+				break;
+
+			// unordered compares set every flag, so NaN only satisfies not equal
+			NumberComparison::Operation operation = NumberComparison::Operation(op.Operator);
+			bool swap = operation == NumberComparison::Operation::LessThan || operation == NumberComparison::Operation::LessThanEqual;
+
+			Op({ 0xF3 }, { 0x0F, 0x10 }, false, 0, SlotBase, SlotValue(swap ? op.B : op.A));
+			Op({}, { 0x0F, 0x2E }, false, 0, SlotBase, SlotValue(swap ? op.A : op.B));	// ucomiss
+
+			switch (operation)
+			{
+				case NumberComparison::Operation::GreaterThan:
+				case NumberComparison::Operation::LessThan:
+					Bytes({ 0x0F, 0x97, 0xC0 });	// seta al
+					break;
+				case NumberComparison::Operation::GreaterThanEqual:
+				case NumberComparison::Operation::LessThanEqual:
+					Bytes({ 0x0F, 0x93, 0xC0 });	// setae al
+					break;
+				case NumberComparison::Operation::Equal:
+					Bytes({ 0x0F, 0x94, 0xC0, 0x0F, 0x9B, 0xC1, 0x20, 0xC8 });		// sete al, setnp cl, and al, cl
+					break;
+				default:
+					Bytes({ 0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1, 0x08, 0xC8 });		// setne al, setp cl, or al, cl
+					break;
+			}
+
+			Op({}, { 0x88 }, false, RAX, SlotBase, dest);
+			StoreTag(op.Dest, ValueTypes::Boolean);
+			return true;
+		}
+
+		case ValueOpCode::BooleanComparison:
+			if (!bools || op.Operator >= uint8_t(BooleanComparison::Operation::LAST_OP))
+				break;
+
+			Op({}, { 0x0F, 0xB6 }, false, RAX, SlotBase, SlotValue(op.A));
+			Op({}, { uint8_t(op.Operator == uint8_t(BooleanComparison::Operation::AND) ? 0x22 : 0x0A) }, false, RAX, SlotBase, SlotValue(op.B));
+			Op({}, { 0x88 }, false, RAX, SlotBase, dest);
+			StoreTag(op.Dest, ValueTypes::Boolean);
+			return true;
+
+		case ValueOpCode::Not:
+			if (!IsSlot(op.A, ValueTypes::Boolean))
+				break;
+
+			Op({}, { 0x0F, 0xB6 }, false, RAX, SlotBase, SlotValue(op.A));
+			Bytes({ 0x34, 0x01 });		// xor al, 1
+			Op({}, { 0x88 }, false, RAX, SlotBase, dest);
+			StoreTag(op.Dest, ValueTypes::Boolean);
+			return true;
+
+		case ValueOpCode::LoadBoolGlobal:
+			Op({}, { 0x0F, 0xB6 }, false, RAX, BoolBase, int32_t(op.A));
+			Bytes({ 0x84, 0xC0, 0x0F, 0x95, 0xC0 });		// test al, al, setne al
+			Op({}, { 0x88 }, false, RAX, SlotBase, dest);
+			StoreTag(op.Dest, ValueTypes::Boolean);
+			return true;
+
+		case ValueOpCode::LoadNumberGlobal:
+			Op({ 0xF3 }, { 0x0F, 0x10 }, false, 0, NumberBase, int32_t(op.A * 4));
+			Op({ 0xF3 }, { 0x0F, 0x11 }, false, 0, SlotBase, dest);
+			StoreTag(op.Dest, ValueTypes::Number);
+			return true;
+
+		case ValueOpCode::LoadStringGlobal:
+			Op({}, { 0x8B }, true, RAX, StringBase, int32_t(op.A * 8));
+			Op({}, { 0x89 }, true, RAX, SlotBase, dest);
+			StoreTag(op.Dest, ValueTypes::String);
+			return true;
+
+		case ValueOpCode::LoopIndex:
+			Op({}, { 0x8B }, false, RAX, RSP, int32_t(LoopState(op.NodeId) * 4));
+			Bytes({ 0x31, 0xC9, 0x85, 0xC0, 0x0F, 0x48, 0xC1 });		// xor ecx, ecx, test eax, eax, cmovs eax, ecx
+			Bytes({ 0xF3, 0x0F, 0x2A, 0xC0 });							// cvtsi2ss xmm0, eax
+			Op({ 0xF3 }, { 0x0F, 0x11 }, false, 0, SlotBase, dest);
+			StoreTag(op.Dest, ValueTypes::Number);
+			return true;
+
+		case ValueOpCode::Convert:
+			if (op.Operator == uint8_t(ValueTypes::Number) && IsSlot(op.A, ValueTypes::Boolean))
+			{
+				Op({}, { 0x0F, 0xB6 }, false, RAX, SlotBase, SlotValue(op.A));
+				Bytes({ 0xF3, 0x0F, 0x2A, 0xC0 });		// cvtsi2ss xmm0, eax
+				Op({ 0xF3 }, { 0x0F, 0x11 }, false, 0, SlotBase, dest);
+				StoreTag(op.Dest, ValueTypes::Number);
+				return true;
+			}
+
+			if (op.Operator == uint8_t(ValueTypes::Boolean) && IsSlot(op.A, ValueTypes::Number))
+			{
+				// NaN is not zero, so unordered counts as true
+				Bytes({ 0x0F, 0x57, 0xC9 });			// xorps xmm1, xmm1
+				Op({}, { 0x0F, 0x2E }, false, 1, SlotBase, SlotValue(op.A));
+				Bytes({ 0x0F, 0x95, 0xC0, 0x0F, 0x9A, 0xC1, 0x08, 0xC8 });		// setne al, setp cl, or al, cl
+				Op({}, { 0x88 }, false, RAX, SlotBase, dest);
+				StoreTag(op.Dest, ValueTypes::Boolean);
+				return true;
+			}
+			break;
+
+		case ValueOpCode::Native:
+			Error = std::string("value node type ") + op.Source->TypeName() + " has no template";
+			return false;
+
+		default:
+			break;
+	}
+
+	// name based globals, conversions and the rarer math go through the interpreter
+	Bytes({ 0x4C, 0x89, 0xE7 });
+	Byte(0xBE);
+	UInt(index);
+	Call((const void*)&ScriptJit::CallValue);
+	return true;
+}
+
+uint32_t ScriptJit::Target(uint32_t pc, uint32_t context)
+{
+	// the end of a chain goes back to the loop that started it, or ends the run
+	if (pc == ScriptProgram::InvalidTarget)
+	{
+		if (context == 0)
+			return ReturnBlock;
+
+		const Context& loop = Contexts[context];
+		return Target(loop.LoopPc, loop.Parent);
+	}
+
+	auto itr = BlockIndexes.find({ pc, context });
+	if (itr != BlockIndexes.end())
+		return itr->second;
+
+	Block block;
+	block.Pc = pc;
+	block.Context = context;
+	Blocks.push_back(block);
+
+	uint32_t index = uint32_t(Blocks.size() - 1);
+	BlockIndexes[{ pc, context }] = index;
+	return index;
+}
+
+uint32_t ScriptJit::EnterLoop(uint32_t loopPc, uint32_t context)
+{
+	// a loop that cycles back into itself keeps growing the return stack, leave that to the interpreter
+	for (uint32_t i = context; i != uint32_t(-1); i = Contexts[i].Parent)
+	{
+		if (Contexts[i].LoopPc == loopPc)
+		{
+			Error = "a loop re-enters itself before completing";
+			return uint32_t(-1);
+		}
+	}
+
+	if (Contexts[context].Depth + 1 > MaxLoopDepth)
+	{
+		Error = "loops are nested too deeply";
+		return uint32_t(-1);
+	}
+
+	for (uint32_t i = 0; i < uint32_t(Contexts.size()); i++)
+	{
+		if (Contexts[i].LoopPc == loopPc && Contexts[i].Parent == context)
+			return i;
+	}
+
+	Context loop;
+	loop.LoopPc = loopPc;
+	loop.Parent = context;
+	loop.Depth = Contexts[context].Depth + 1;
+	Contexts.push_back(loop);
+	return uint32_t(Contexts.size() - 1);
+}
+
+uint32_t ScriptJit::LoopState(uint32_t nodeId)
+{
+	auto itr = LoopStates.find(nodeId);
+	if (itr != LoopStates.end())
+		return itr->second;
+
+	uint32_t state = uint32_t(LoopStates.size());
+	LoopStates[nodeId] = state;
+	return state;
+}
+
+void ScriptJit::Byte(uint8_t value)
+{
+	Code.push_back(value);
+}
+
+void ScriptJit::Bytes(std::initializer_list<uint8_t> values)
+{
+	Code.insert(Code.end(), values.begin(), values.end());
+}
+
+void ScriptJit::UInt(uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+		Byte(uint8_t(value >> (i * 8)));
+}
+
+void ScriptJit::UInt64(uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+		Byte(uint8_t(value >> (i * 8)));
+}
+
+void ScriptJit::Rex(bool wide, uint32_t reg, uint32_t base)
+{
+	uint8_t rex = uint8_t(0x40 | (wide ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((base & 8) ? 0x01 : 0));
+	if (rex != 0x40)
+		Byte(rex);
+}
+
+void ScriptJit::Memory(uint32_t reg, uint32_t base, int32_t disp)
+{
+	// always [base + disp32], rsp and r12 need a SIB byte to be used as a base
+	Byte(uint8_t(0x80 | ((reg & 7) << 3) | (base & 7)));
+	if ((base & 7) == RSP)
+		Byte(0x24);
+
+	UInt(uint32_t(disp));
+}
+
+void ScriptJit::Op(std::initializer_list<uint8_t> prefix, std::initializer_list<uint8_t> opcode, bool wide, uint32_t reg, uint32_t base, int32_t disp)
+{
+	Bytes(prefix);
+	Rex(wide, reg, base);
+	Bytes(opcode);
+	Memory(reg, base, disp);
+}
+
+void ScriptJit::JumpTo(uint32_t block)
+{
+	Byte(0xE9);
+	if (block == ReturnBlock)
+		ReturnFixups.push_back(Code.size());
+	else
+		Fixups.push_back({ Code.size(), block });
+	UInt(0);
+}
+
+void ScriptJit::JumpIf(uint8_t condition, uint32_t block)
+{
+	Bytes({ 0x0F, uint8_t(0x80 | condition) });
+	if (block == ReturnBlock)
+		ReturnFixups.push_back(Code.size());
+	else
+		Fixups.push_back({ Code.size(), block });
+	UInt(0);
+}
+
+void ScriptJit::Call(const void* function)
+{
+	// mov rax, imm64, call rax, the code can end up anywhere so nothing is rip relative
+	Bytes({ 0x48, 0xB8 });
+	UInt64(uint64_t(uintptr_t(function)));
+	Bytes({ 0xFF, 0xD0 });
+}
+
+void ScriptJit::LoadBoolean(uint32_t slot)
+{
+	// leaves the zero flag clear when the value is true
+	if (IsSlot(slot, ValueTypes::Boolean))
+	{
+		Op({}, { 0x80 }, false, 7, SlotBase, SlotValue(slot));		// cmp byte, 0
+		Byte(0);
+		return;
+	}
+
+	Op({}, { 0x8D }, true, RDI, SlotBase, int32_t(slot * sizeof(ValueData)));		// lea rdi
+	Call((const void*)&ScriptJit::CallBoolean);
+	Bytes({ 0x84, 0xC0 });		// test al, al
+}
+
+void ScriptJit::StoreTag(uint32_t slot, ValueTypes type)
+{
+	// a slot with a single type already has the right tag from the program's initial slots
+	if (Program->HasFixedType(slot))
+		return;
+
+	Op({}, { 0xC7 }, false, 0, SlotBase, SlotTag(slot));
+	UInt(uint32_t(type));
+}
+
+int32_t ScriptJit::SlotValue(uint32_t slot) const
+{
+	return int32_t(slot * sizeof(ValueData) + offsetof(ValueData, NumberValue));
+}
+
+int32_t ScriptJit::SlotTag(uint32_t slot) const
+{
+	return int32_t(slot * sizeof(ValueData) + offsetof(ValueData, Type));
+}
+
+void ScriptJit::CallValue(ScriptInstance* instance, uint32_t index)
+{
+	instance->EvaluateValues(index, index + 1);
+}
+
+void ScriptJit::CallInstruction(ScriptInstance* instance, uint32_t pc)
+{
+	const Instruction ins = ScriptProgram::Unfuse(instance->Program->Code[pc]);
+	const ValueData* slots = instance->Slots.data();
+
+	const ValueData* arg0 = ins.Args[0] != ScriptProgram::InvalidSlot ? slots + ins.Args[0] : nullptr;
+	const ValueData* arg1 = ins.Args[1] != ScriptProgram::InvalidSlot ? slots + ins.Args[1] : nullptr;
+
+	std::string name;
+	std::string text;
+
+	switch (ins.Op)
+	{
+		case OpCode::PrintLog:
+			PrintLog::LogFunction(arg0->String(text));
+			break;
+
+		case OpCode::SaveBool:
+			instance->SetBool(arg0->String(name), arg1->Boolean());
+			break;
+
+		case OpCode::SaveNumber:
+			instance->SetNumber(arg0->String(name), arg1->Number());
+			break;
+
+		case OpCode::SaveString:
+			instance->SetString(arg0->String(name), arg1->String(text));
+			break;
+
+		case OpCode::SaveBoolGlobal:
+			instance->BoolGlobalSlots[ins.Operand] = arg1->Boolean();
+			break;
+
+		case OpCode::SaveNumberGlobal:
+			instance->NumGlobalSlots[ins.Operand] = arg1->Number();
+			break;
+
+		case OpCode::SaveStringGlobal:
+			instance->SetStringGlobal(ins.Operand, *arg1, instance->Program->IsConstant(ins.Args[1]));
+			break;
+
+		default:
+			break;
+	}
+}
+
+bool ScriptJit::CallBoolean(const ValueData* value)
+{
+	return value->Boolean();
+}
@@ -0,0 +1,229 @@
+#include "script_profiler.h"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SCRIPT_PROFILER_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SCRIPT_PROFILER_TSC 1
+#endif
+
+ScriptProfiler::ScriptProfiler()
+{
+	Reset();
+}
+
+void ScriptProfiler::Reset()
+{
+	Nodes.clear();
+	Stacks.clear();
+	Events.clear();
+	Path.clear();
+	Root = uint32_t(-1);
+
+	StartTicks = Now();
+	StartTime = std::chrono::steady_clock::now();
+}
+
+uint64_t ScriptProfiler::Now()
+{
+#if defined(SCRIPT_PROFILER_TSC)
+	return __rdtsc();
+#else
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+double ScriptProfiler::GetTicksPerMicrosecond() const
+{
+	// measured against the steady clock since the last reset, short profiles wait a little to get a usable ratio
+	auto minimum = StartTime + std::chrono::milliseconds(10);
+	if (std::chrono::steady_clock::now() < minimum)
+		std::this_thread::sleep_until(minimum);
+
+	uint64_t ticks = Now() - StartTicks;
+	double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - StartTime).count();
+	return micros > 0 && ticks > 0 ? ticks / micros : 1.0;
+}
+
+void ScriptProfiler::BeginRun(uint32_t entryNodeId)
+{
+	Root = entryNodeId;
+}
+
+bool ScriptProfiler::EnterNode(ScriptInstance& instance, uint32_t pc)
+{
+	const ScriptProgram& program = *instance.GetProgram();
+	uint32_t nodeId = program.Code[pc].NodeId;
+
+	Path.clear();
+	if (Root != uint32_t(-1))
+		Path.push_back(Root);
+
+	// every loop the node runs inside of, outermost first
+	for (uint32_t loopPc : instance.ReturnStack)
+	{
+		uint32_t loopId = program.Code[loopPc].NodeId;
+		if (Path.empty() || Path.back() != loopId)
+			Path.push_back(loopId);
+	}
+
+	if (Path.empty() || Path.back() != nodeId)
+		Path.push_back(nodeId);
+
+	ValueTicks = 0;
+	Start = Now();
+	return true;
+}
+
+void ScriptProfiler::ExitNode(ScriptInstance& instance, uint32_t pc)
+{
+	uint64_t ticks = Now() - Start;
+	uint64_t exclusive = ticks - std::min(ticks, ValueTicks);
+	uint32_t nodeId = Path.back();
+
+	NodeStats& stats = Nodes[nodeId];
+	stats.Count++;
+	stats.ExclusiveTicks += exclusive;
+
+	// every argument is a read, even a constant or folded one that has no value op to run
+	for (uint32_t arg : instance.GetProgram()->Code[pc].Args)
+	{
+		if (arg != ScriptProgram::InvalidSlot)
+			stats.ValueReads++;
+	}
+
+	for (uint32_t id : Path)
+		Nodes[id].InclusiveTicks += ticks;
+
+	Stacks[Path] += exclusive;
+	AddEvent(nodeId, uint32_t(Path.size() - 1), Start, ticks);
+}
+
+void ScriptProfiler::ReadValue(uint32_t valueNodeId, uint64_t start, uint64_t end)
+{
+	uint64_t ticks = end - start;
+	ValueTicks += ticks;
+
+	if (!Path.empty())
+		Nodes[Path.back()].ValueReads++;
+
+	NodeStats& stats = Nodes[valueNodeId];
+	stats.Count++;
+	stats.InclusiveTicks += ticks;
+	stats.ExclusiveTicks += ticks;
+
+	Path.push_back(valueNodeId);
+	Stacks[Path] += ticks;
+	Path.pop_back();
+
+	AddEvent(valueNodeId, uint32_t(Path.size()), start, ticks);
+}
+
+void ScriptProfiler::CountRead(uint32_t nodeId)
+{
+	if (nodeId != uint32_t(-1))
+		Nodes[nodeId].ValueReads++;
+}
+
+void ScriptProfiler::AddEvent(uint32_t nodeId, uint32_t depth, uint64_t start, uint64_t ticks)
+{
+	if (Events.size() >= MaxEvents)
+		return;
+
+	TraceEvent& event = Events.emplace_back();
+	event.NodeId = nodeId;
+	event.Depth = depth;
+	event.Start = start;
+	event.Ticks = ticks;
+}
+
+std::string ScriptProfiler::GetLabel(const ScriptGraph& graph, uint32_t nodeId) const
+{
+	const Node* node = graph.FindNode(nodeId);
+	if (!node)
+		return "node " + std::to_string(nodeId);
+
+	std::string label = std::string(node->TypeName()) + " " + std::to_string(nodeId);
+	if (!node->Name.empty())
+		label += " (" + node->Name + ")";
+
+	// both exports use these as plain tokens
+	for (char& c : label)
+	{
+		if (c == ';' || c == '"' || c == '\\' || c == '\n')
+			c = '_';
+	}
+	return label;
+}
+
+std::string ScriptProfiler::GetReport(const ScriptGraph& graph) const
+{
+	if (Nodes.empty())
+		return "no samples\n";
+
+	std::vector<std::pair<uint32_t, const NodeStats*>> sorted;
+	for (const auto& [id, stats] : Nodes)
+		sorted.emplace_back(id, &stats);
+
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second->ExclusiveTicks > b.second->ExclusiveTicks; });
+
+	double scale = 1.0 / GetTicksPerMicrosecond();
+
+	std::string report;
+	char line[256];
+	for (const auto& [id, stats] : sorted)
+	{
+		snprintf(line, sizeof(line), " x%llu, inclusive %.1fus, exclusive %.1fus, reads %llu\n",
+			(unsigned long long)stats->Count, stats->InclusiveTicks * scale, stats->ExclusiveTicks * scale, (unsigned long long)stats->ValueReads);
+		report += GetLabel(graph, id) + line;
+	}
+
+	return report;
+}
+
+std::string ScriptProfiler::GetFlamegraph(const ScriptGraph& graph) const
+{
+	double scale = 1.0 / GetTicksPerMicrosecond();
+
+	std::string folded;
+	for (const auto& [path, ticks] : Stacks)
+	{
+		for (size_t i = 0; i < path.size(); i++)
+		{
+			if (i > 0)
+				folded += ";";
+			folded += GetLabel(graph, path[i]);
+		}
+
+		// flamegraph tools want whole numbers, anything under a microsecond still shows up
+		uint64_t micros = uint64_t(ticks * scale + 0.5);
+		folded += " " + std::to_string(std::max<uint64_t>(micros, 1)) + "\n";
+	}
+
+	return folded;
+}
+
+std::string ScriptProfiler::GetChromeTrace(const ScriptGraph& graph) const
+{
+	double scale = 1.0 / GetTicksPerMicrosecond();
+
+	std::string trace = "{\"traceEvents\":[\n";
+	char line[128];
+	for (size_t i = 0; i < Events.size(); i++)
+	{
+		const TraceEvent& event = Events[i];
+		double start = event.Start >= StartTicks ? (event.Start - StartTicks) * scale : 0.0;
+
+		trace += "{\"name\":\"" + GetLabel(graph, event.NodeId) + "\",\"cat\":\"script\",\"ph\":\"X\"";
+		snprintf(line, sizeof(line), ",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"depth\":%u}}", start, event.Ticks * scale, event.Depth);
+		trace += line;
+		trace += i + 1 < Events.size() ? ",\n" : "\n";
+	}
+	trace += "],\"displayTimeUnit\":\"ns\"}\n";
+
+	return trace;
+}
@@ -1,4 +1,13 @@
 #include "script_graph.h"
+#include "script_program.h"
+#include "script_jit.h"
+#include "script_profiler.h"
+#include "script_instrumentation.h"
+#include "script_sampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
 
 
 namespace NodeRegistry
@@ -13,12 +22,14 @@ namespace NodeRegistry
 
 	std::map<std::string, NodeFactory> NodeTypeDb;
 
-	void NodeRegistry::RegisterNode(const char* typeName, std::function<Node* ()> newFactory, std::function<Node* (void*, size_t)> loadFactory)
+	std::map<uint64_t, std::map<std::string, PrecompiledEntry>> PrecompiledDb;
+
+	void RegisterNode(const char* typeName, std::function<Node* ()> newFactory, std::function<Node* (void*, size_t)> loadFactory)
 	{
 		NodeTypeDb[typeName] = NodeFactory{ newFactory, loadFactory, typeName };
 	}
 
-	Node* NodeRegistry::CreateNode(const char* typeName)
+	Node* CreateNode(const char* typeName)
 	{
 		auto itr = NodeTypeDb.find(typeName);
 		if (itr == NodeTypeDb.end())
@@ -27,7 +38,7 @@ namespace NodeRegistry
 		return itr->second.NewFactory();
 	}
 
-	Node* NodeRegistry::LoadNode(const char* typeName, void* data, size_t size)
+	Node* LoadNode(const char* typeName, void* data, size_t size)
 	{
 		auto itr = NodeTypeDb.find(typeName);
 		if (itr == NodeTypeDb.end())
@@ -41,6 +52,7 @@ namespace NodeRegistry
 		RegisterNode<EntryNode>();
 		RegisterNode<Condition>();
 		RegisterNode<Loop>();
+		RegisterNode<Delay>();
 		RegisterNode<BooleanComparison>();
 		RegisterNode<NotComparison>();
 		RegisterNode<NumberComparison>();
@@ -80,82 +92,661 @@ namespace NodeRegistry
 		static std::string empty;
 		return empty;
 	}
+
+	void RegisterPrecompiledEntry(uint64_t programHash, const char* entryName, PrecompiledEntry function)
+	{
+		PrecompiledDb[programHash][entryName] = function;
+	}
+
+	PrecompiledEntry FindPrecompiledEntry(uint64_t programHash, const std::string& entryName)
+	{
+		auto programItr = PrecompiledDb.find(programHash);
+		if (programItr == PrecompiledDb.end())
+			return nullptr;
+
+		auto itr = programItr->second.find(entryName);
+		if (itr == programItr->second.end())
+			return nullptr;
+
+		return itr->second;
+	}
 }
 
-ScriptInstance::ScriptInstance(ScriptGraph& graph)
+namespace
+{
+	// moves globals that were set by name into the slots the program bound them to
+	template<class T, class S>
+	void BindGlobals(std::unordered_map<std::string, T>& named, const std::unordered_map<std::string, uint32_t>& symbols, std::vector<S>& slots)
+	{
+		if (named.empty())
+			return;
+
+		for (const auto& [name, index] : symbols)
+		{
+			auto itr = named.find(name);
+			if (itr == named.end())
+				continue;
+
+			slots[index] = S(itr->second);
+			named.erase(itr);
+		}
+	}
+
+	// the reverse, moves bound globals back under their names before the slots are dropped for another program
+	template<class T, class S>
+	void UnbindGlobals(std::unordered_map<std::string, T>& named, const std::unordered_map<std::string, uint32_t>& symbols, std::vector<S>& slots)
+	{
+		for (const auto& [name, index] : symbols)
+		{
+			if (index < slots.size())
+				named[name] = T(slots[index]);
+		}
+
+		slots.clear();
+	}
+
+	// compiles are rare, one lock for every graph is enough
+	std::mutex CompileLock;
+}
+
+void ScriptGraph::Compile()
+{
+	Verify();
+
+	auto program = std::make_shared<ScriptProgram>();
+	program->Compile(*this);
+	program->Unchecked = VerifyErrors.empty();
+
+	// instances on other threads may be checking for a program to compile
+	std::atomic_store(&Program, std::shared_ptr<const ScriptProgram>(program));
+}
+
+const std::shared_ptr<const ScriptProgram>& ScriptGraph::GetCompiledProgram() const
+{
+	if (!std::atomic_load(&Program))
+	{
+		std::lock_guard<std::mutex> lock(CompileLock);
+
+		// compiling only rebuilds the tables derived from the nodes, the nodes themselves are left as they are
+		if (!Program)
+			const_cast<ScriptGraph*>(this)->Compile();
+	}
+
+	return Program;
+}
+
+ScriptInstance::ScriptInstance(const ScriptGraph& graph)
 	: Graph(graph)
 {
 
 }
 
-bool ScriptInstance::RunStep()
+void ScriptInstance::EvaluateValues(uint32_t begin, uint32_t end)
 {
-	const NodeRef* nextNode = Graph.Nodes[CurrentNode]->Process(*this);
+	const ValueOp* ops = Program->ValueCode.data();
+	ValueData* slots = Slots.data();
+
+	// names are interned strings, this only holds text for a name made from a number or bool
+	std::string name;
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const ValueOp& op = ops[i];
+		ValueData& dest = slots[op.Dest];
+
+		// the compiler put a Convert in front of anything that could arrive as the wrong type, so inputs are read raw
+		switch (op.Op)
+		{
+			case ValueOpCode::Math:
+				dest.SetNumber(Math::Evaluate(Math::Operation(op.Operator), slots[op.A].NumberValue, slots[op.B].NumberValue));
+				break;
+
+			case ValueOpCode::NumberComparison:
+				dest.SetBool(NumberComparison::Evaluate(NumberComparison::Operation(op.Operator), slots[op.A].NumberValue, slots[op.B].NumberValue));
+				break;
+
+			case ValueOpCode::BooleanComparison:
+				dest.SetBool(BooleanComparison::Evaluate(BooleanComparison::Operation(op.Operator), slots[op.A].BoolValue, slots[op.B].BoolValue));
+				break;
+
+			case ValueOpCode::Not:
+				dest.SetBool(!slots[op.A].BoolValue);
+				break;
+
+			case ValueOpCode::LoadBool:
+				dest.SetBool(GetBool(slots[op.A].String(name)));
+				break;
+
+			case ValueOpCode::LoadNumber:
+				dest.SetNumber(GetNumber(slots[op.A].String(name)));
+				break;
+
+			case ValueOpCode::LoadString:
+				SetValueString(dest, GetString(slots[op.A].String(name)));
+				break;
+
+			case ValueOpCode::LoadBoolGlobal:
+				dest.SetBool(BoolGlobalSlots[op.A] != 0);
+				break;
+
+			case ValueOpCode::LoadNumberGlobal:
+				dest.SetNumber(NumGlobalSlots[op.A]);
+				break;
+
+			case ValueOpCode::LoadStringGlobal:
+				dest.SetString(StringGlobalSlots[op.A]);
+				break;
+
+			case ValueOpCode::LoopIndex:
+			{
+				int32_t index = LoopFrames[op.A];
+				dest.SetNumber(index > 0 ? float(index) : 0.0f);
+				break;
+			}
+
+			case ValueOpCode::Convert:
+				switch (ValueTypes(op.Operator))
+				{
+					case ValueTypes::Boolean:
+						dest.SetBool(slots[op.A].Boolean());
+						break;
+					case ValueTypes::Number:
+						dest.SetNumber(slots[op.A].Number());
+						break;
+					default:
+						SetValueString(dest, slots[op.A]);
+						break;
+				}
+				break;
+
+			case ValueOpCode::Native:
+			{
+				// most natives write straight into their own slot
+				const ValueData* value = op.Source->GetValue(op.ValueId, *this);
+				if (value && value != &dest)
+				{
+					// text another value owns is copied, so the slot never changes behind the reader's back
+					if (value->Type == ValueTypes::String)
+						SetValueString(dest, *value);
+					else
+						dest = *value;
+				}
+				break;
+			}
+		}
+	}
+}
 
-	if (nextNode == nullptr || nextNode->ID >= Graph.Nodes.size())
+template<class Policy>
+inline void ScriptInstance::ReadValues(Policy& policy, uint32_t begin, uint32_t end)
+{
+	if constexpr (!Policy::ValueHooks)
+	{
+		EvaluateValues(begin, end);
+	}
+	else
 	{
-		if (ReturnStack.size() > 0)
+		const ValueOp* ops = Program->ValueCode.data();
+		for (uint32_t i = begin; i < end; i++)
 		{
-			CurrentNode = ReturnStack.top();
-			ReturnStack.pop();
-			return true;
+			policy.EnterValue(*this, ops[i]);
+			EvaluateValues(i, i + 1);
+			policy.ExitValue(*this, ops[i]);
 		}
+	}
+}
 
+uint32_t ScriptInstance::Execute(uint32_t maxInstructions)
+{
+#if !defined(SCRIPT_GRAPH_NO_INSTRUMENTATION)
+	// the policy is picked once per call, inside the loop the hooks are direct calls or nothing
+	if (Debugger)
+		return ExecuteProgram(*Debugger, maxInstructions);
+
+	if (Profiler)
+		return ExecuteProgram(*Profiler, maxInstructions);
+
+	if (Counters)
+		return ExecuteProgram(*Counters, maxInstructions);
+
+	if (Sampler)
+	{
+		Sampler->BeginExecute();
+		return ExecuteProgram(*Sampler, maxInstructions);
+	}
+#endif
+
+	NoInstrumentation none;
+	return ExecuteProgram(none, maxInstructions);
+}
+
+template<class Policy>
+uint32_t ScriptInstance::ExecuteProgram(Policy& policy, uint32_t maxInstructions)
+{
+	const Instruction* code = Program->Code.data();
+	const ValueOp* ops = Program->ValueCode.data();
+	const ValueData* slots = Slots.data();
+
+	// text for printing or saving a number or bool, strings are read in place
+	std::string name;
+	std::string text;
+
+	uint32_t count = 0;
+	while (count < maxInstructions && ProgramCounter != ScriptProgram::InvalidTarget && !Waiting)
+	{
+		const Instruction& ins = code[ProgramCounter];
+		uint32_t pc = ProgramCounter;
+		if (!policy.EnterNode(*this, pc))
+			break;
+
+		CurrentNode = ins.NodeId;
+		count++;
+
+		[[maybe_unused]] uint32_t globalEpoch = GlobalEpoch;
+		NextStep();
+
+		// loops evaluate their condition once the index has moved
+		if (ins.Op != OpCode::Loop && ins.Op != OpCode::LoopPrint && ins.ValueBegin != ins.ValueEnd)
+			ReadValues(policy, ins.ValueBegin, ins.ValueEnd);
+
+		const ValueData* arg0 = ins.Args[0] != ScriptProgram::InvalidSlot ? slots + ins.Args[0] : nullptr;
+		const ValueData* arg1 = ins.Args[1] != ScriptProgram::InvalidSlot ? slots + ins.Args[1] : nullptr;
+
+		uint32_t next = ScriptProgram::InvalidTarget;
+		bool fusedPrint = false;
+
+		switch (ins.Op)
+		{
+			case OpCode::Entry:
+			case OpCode::Jump:
+				next = ins.Next[0];
+				break;
+
+			case OpCode::Condition:
+				if (arg0)
+					next = arg0->BoolValue ? ins.Next[0] : ins.Next[1];
+				break;
+
+			case OpCode::CompareBranch:
+			{
+				const ValueOp& compare = ops[ins.Fused];
+				bool result = NumberComparison::Evaluate(NumberComparison::Operation(compare.Operator), slots[compare.A].NumberValue, slots[compare.B].NumberValue);
+				next = result ? ins.Next[0] : ins.Next[1];
+				break;
+			}
+
+			case OpCode::Loop:
+			case OpCode::LoopPrint:
+			{
+				uint32_t index = uint32_t(++LoopFrames[ins.Frame]);
+				if (ins.Operand > 0 && index >= ins.Operand)
+				{
+					next = ins.Next[0];
+					break;
+				}
+
+				if (ins.ValueBegin != ins.ValueEnd)
+					ReadValues(policy, ins.ValueBegin, ins.ValueEnd);
+
+				if (arg0 && !arg0->BoolValue)
+				{
+					next = ins.Next[0];
+					break;
+				}
+
+				// the print body comes straight back here, it runs in place once this node is done
+				if (ins.Op == OpCode::LoopPrint)
+				{
+					fusedPrint = true;
+					next = pc;
+					break;
+				}
+
+				ReturnStack.push_back(ProgramCounter);
+				next = ins.Next[1];
+				break;
+			}
+
+			case OpCode::PrintLog:
+				if (arg0)
+					PrintLog::LogFunction(arg0->String(text));
+
+				next = ins.Next[0];
+				break;
+
+			case OpCode::SaveBool:
+				if (arg0 && arg1)
+					SetBool(arg0->String(name), arg1->BoolValue);
+
+				next = ins.Next[0];
+				break;
+
+			case OpCode::SaveNumber:
+				if (arg0 && arg1)
+					SetNumber(arg0->String(name), arg1->NumberValue);
+
+				next = ins.Next[0];
+				break;
+
+			case OpCode::SaveString:
+				if (arg0 && arg1)
+					SetString(arg0->String(name), arg1->String(text));
+
+				next = ins.Next[0];
+				break;
+
+			case OpCode::SaveBoolGlobal:
+				if (arg1)
+				{
+					BoolGlobalSlots[ins.Operand] = arg1->BoolValue;
+					GlobalEpoch++;
+				}
+
+				next = ins.Next[0];
+				break;
+
+			case OpCode::SaveNumberGlobal:
+				if (arg1)
+				{
+					NumGlobalSlots[ins.Operand] = arg1->NumberValue;
+					GlobalEpoch++;
+				}
+
+				next = ins.Next[0];
+				break;
+
+			case OpCode::NumberGlobalUpdate:
+			{
+				const ValueOp& load = ops[ins.Fused];
+				const ValueOp& math = ops[ins.Fused + 1];
+
+				float global = NumGlobalSlots[load.A];
+				float a = math.A == load.Dest ? global : slots[math.A].NumberValue;
+				float b = math.B == load.Dest ? global : slots[math.B].NumberValue;
+
+				NumGlobalSlots[ins.Operand] = Math::Evaluate(Math::Operation(math.Operator), a, b);
+				GlobalEpoch++;
+
+				next = ins.Next[0];
+				break;
+			}
+
+			case OpCode::SaveStringGlobal:
+				if (arg1)
+				{
+					SetStringGlobal(ins.Operand, *arg1, Program->IsConstant(ins.Args[1]));
+					GlobalEpoch++;
+				}
+
+				next = ins.Next[0];
+				break;
+
+			case OpCode::Delay:
+				Suspend(arg0 ? arg0->NumberValue : 0.0f);
+				next = ins.Next[0];
+				break;
+
+			case OpCode::Native:
+			{
+				const NodeRef* nextRef = ins.Source->Process(*this);
+				if (!nextRef)
+					break;
+
+				// a verified graph's refs still have the index they were compiled with
+				if (Program->Unchecked)
+				{
+					next = Program->FindInstruction(nextRef->Index);
+					break;
+				}
+
+				const Node* nextNode = Graph.GetNode(*nextRef);
+				if (nextNode)
+					next = Program->FindInstruction(nextNode->Index);
+				break;
+			}
+		}
+
+		if constexpr (Policy::ExitHooks)
+		{
+			policy.ExitNode(*this, pc);
+			if (GlobalEpoch != globalEpoch)
+				policy.WriteGlobal(*this, pc);
+		}
+
+		// the print is a node of its own, it counts against the budget and the policy sees it,
+		// when either stops in front of it the body is entered the plain way from the next step
+		if (fusedPrint)
+		{
+			// seen from the policy the print runs inside its loop, the same as it does unfused
+			if constexpr (Policy::ExitHooks)
+				ReturnStack.push_back(pc);
+
+			if (count >= maxInstructions || !policy.EnterNode(*this, ins.Fused))
+			{
+				if constexpr (!Policy::ExitHooks)
+					ReturnStack.push_back(pc);
+
+				ProgramCounter = ins.Fused;
+				break;
+			}
+
+			const Instruction& print = code[ins.Fused];
+			CurrentNode = print.NodeId;
+			count++;
+
+			NextStep();
+			if (print.ValueBegin != print.ValueEnd)
+				ReadValues(policy, print.ValueBegin, print.ValueEnd);
+
+			PrintLog::LogFunction(slots[print.Args[0]].String(text));
+
+			if constexpr (Policy::ExitHooks)
+			{
+				policy.ExitNode(*this, ins.Fused);
+				ReturnStack.pop_back();
+			}
+		}
+
+		if (next == ScriptProgram::InvalidTarget && !ReturnStack.empty())
+		{
+			next = ReturnStack.back();
+			ReturnStack.pop_back();
+		}
+
+		ProgramCounter = next;
+	}
+
+	if (ProgramCounter == ScriptProgram::InvalidTarget)
 		CurrentNode = uint32_t(-1);
+
+	return count;
+}
+
+ScriptGraph::EntryHandle ScriptGraph::GetEntryHandle(const std::string& name) const
+{
+	const auto& program = GetCompiledProgram();
+	if (!program)
+		return InvalidEntry;
+
+	return program->FindEntryHandle(name);
+}
+
+bool ScriptInstance::Begin(ScriptGraph::EntryHandle entryPoint)
+{
+	// a graph that was never compiled, or was edited since, is compiled here
+	const auto& program = Graph.GetCompiledProgram();
+	if (!program)
 		return false;
+
+	uint32_t entry = program->GetEntryPoint(entryPoint);
+	if (entry == ScriptProgram::InvalidTarget)
+		return false;
+
+	if (program != Program)
+	{
+		// globals kept between runs were bound to the old program's slots, the new one may number them differently
+		if (Program && !ResetGlobals)
+		{
+			UnbindGlobals(BoolGlobals, Program->Globals.Bools, BoolGlobalSlots);
+			UnbindGlobals(NumGlobals, Program->Globals.Numbers, NumGlobalSlots);
+			for (const auto& [name, index] : Program->Globals.Strings)
+			{
+				if (index < StringGlobalSlots.size())
+					StringGlobals[name] = *StringGlobalSlots[index];
+			}
+
+			StringGlobalSlots.clear();
+			GlobalStrings.clear();
+		}
+
+		Program = program;
+		Slots = Program->Slots;
+		SlotStrings.resize(Slots.size());
+		ReturnStack.reserve(Program->LoopFrameCount + 1);
+		ValueCache.assign(Program->CacheSize, ValueCacheEntry());
 	}
-		
-	CurrentNode = nextNode->ID;
+
+	Clear();
+	Running = true;
+
+	ProgramCounter = entry;
+	CurrentNode = Program->Code[entry].NodeId;
+	EntryPoint = entryPoint;
+
+#if !defined(SCRIPT_GRAPH_NO_INSTRUMENTATION)
+	if (Profiler)
+		Profiler->BeginRun(CurrentNode);
+#endif
 	return true;
 }
 
 ScriptInstance::Result ScriptInstance::Run(const std::string& entryPoint)
+{
+	return Run(Graph.GetEntryHandle(entryPoint));
+}
+
+ScriptInstance::Result ScriptInstance::Run(ScriptGraph::EntryHandle entryPoint)
 {
 	if (Running)
 		return Result::Incomplete;
 
-	Clear();
-	Running = true;
-
-	auto itr = Graph.EntryNodes.find(entryPoint);
-	if (itr == Graph.EntryNodes.end() || !itr->second)
+	if (!Begin(entryPoint))
 		return Result::Error;
 
-	CurrentNode = itr->second->ID;
+	// instrumentation needs every node to go through the interpreter
+	bool interpret = IsInstrumented();
+	NodeRegistry::PrecompiledEntry precompiled = UsePrecompiled && !interpret ? Program->GetPrecompiledEntry(entryPoint) : nullptr;
+	ScriptJit::EntryFunction jitted = UseJit && !interpret && Program->Jit ? Program->Jit->GetEntry(entryPoint) : nullptr;
+	if (precompiled)
+	{
+		precompiled(*this);
+		ProgramCounter = ScriptProgram::InvalidTarget;
+		CurrentNode = uint32_t(-1);
 
-	while (true)
+		// generated code writes the global slots directly as well
+		GlobalEpoch++;
+	}
+	else if (jitted)
 	{
-		if(!RunStep())
-			break;
+		jitted(this, Slots.data(), BoolGlobalSlots.data(), NumGlobalSlots.data(), StringGlobalSlots.data());
+		ProgramCounter = ScriptProgram::InvalidTarget;
+		CurrentNode = uint32_t(-1);
+
+		// generated code writes globals without touching the cache epochs
+		GlobalEpoch++;
+	}
+	else
+	{
+		Execute(uint32_t(-1));
 	}
 
-	Running = false;
-	return Result::Complete;
+	return FinishStep();
 }
 
 ScriptInstance::Result ScriptInstance::Start(const std::string& entryPoint)
+{
+	return Start(Graph.GetEntryHandle(entryPoint));
+}
+
+ScriptInstance::Result ScriptInstance::Start(ScriptGraph::EntryHandle entryPoint)
 {
 	if (Running)
 		return Result::Error;
 
-	Clear();
-	Running = true;
-
-	auto itr = Graph.EntryNodes.find(entryPoint);
-	if (itr == Graph.EntryNodes.end() || !itr->second)
+	if (!Begin(entryPoint))
 		return Result::Error;
 
-	CurrentNode = itr->second->ID;
-
 	return Step();
 }
 
 ScriptInstance::Result ScriptInstance::Step()
 {
+	return Step(1).Status;
+}
+
+ScriptInstance::StepResult ScriptInstance::Step(uint32_t maxNodes)
+{
+	StepResult result;
+	if (!Running)
+		return result;
+
+	if (Waiting)
+	{
+		result.Status = Result::Waiting;
+		return result;
+	}
+
+	result.NodesRun = Execute(maxNodes);
+	result.Status = FinishStep();
+	return result;
+}
+
+ScriptInstance::StepResult ScriptInstance::StepFor(std::chrono::steady_clock::time_point deadline)
+{
+	StepResult result;
 	if (!Running)
-		return Result::Complete;
+		return result;
+
+	if (Waiting)
+	{
+		result.Status = Result::Waiting;
+		return result;
+	}
+
+	// the clock is only read between slices, the slice grows while it stays well inside the budget
+	uint32_t slice = 16;
+	auto now = std::chrono::steady_clock::now();
+	while (now < deadline)
+	{
+		uint32_t count = Execute(slice);
+		result.NodesRun += count;
+		if (count < slice)
+			break;
+
+		auto sliceStart = now;
+		now = std::chrono::steady_clock::now();
+
+		if ((now - sliceStart) * 4 < deadline - now)
+			slice = std::min(slice * 2, MaxStepSlice);
+		else if (slice > 1)
+			slice /= 2;
+	}
+
+	result.Status = FinishStep();
+	return result;
+}
+
+ScriptInstance::StepResult ScriptInstance::StepFor(std::chrono::microseconds budget)
+{
+	return StepFor(std::chrono::steady_clock::now() + budget);
+}
 
-	if (RunStep())
+ScriptInstance::Result ScriptInstance::FinishStep()
+{
+	if (Waiting)
+		return Result::Waiting;
+
+	if (ProgramCounter != ScriptProgram::InvalidTarget)
 		return Result::Incomplete;
 
 	Running = false;
@@ -164,23 +755,242 @@ ScriptInstance::Result ScriptInstance::Step()
 
 const ValueData* ScriptInstance::GetValue(const ValueRef& ref)
 {
-	if (ref.ID > Graph.Nodes.size())
+#if !defined(SCRIPT_GRAPH_NO_INSTRUMENTATION)
+	if (Profiler)
+		Profiler->CountRead(CurrentNode);
+#endif
+
+	Node* node = Program && Program->Unchecked ? Graph.GetVerifiedNode(ref) : Graph.GetNode(ref);
+	if (!node)
 		return nullptr;
 
-	return Graph.Nodes[ref.ID]->GetValue(ref.ValueId, *this);
+	// refs without a value ID read the first value, the same as after the graph is compiled
+	uint32_t valueId = ref.ValueId != uint32_t(-1) ? ref.ValueId : 0;
+
+	const ValueCacheInfo* cacheInfo = Program ? Program->FindCachedValue(node->Index) : nullptr;
+	if (!cacheInfo || valueId >= cacheInfo->Count)
+		return node->GetValue(valueId, *this);
+
+	ValueCacheEntry& entry = ValueCache[cacheInfo->Index + valueId];
+	if (entry.StepEpoch == StepEpoch && (!cacheInfo->DependsOnGlobals || entry.GlobalEpoch == GlobalEpoch))
+		return entry.Value;
+
+	entry.Value = node->GetValue(valueId, *this);
+	entry.StepEpoch = StepEpoch;
+	entry.GlobalEpoch = GlobalEpoch;
+	return entry.Value;
+}
+
+ValueData& ScriptInstance::GetNodeValue(const Node& node, uint32_t valueId)
+{
+	// refs without a value ID read the first value
+	if (valueId == uint32_t(-1))
+		valueId = 0;
+
+	uint32_t slot = Program ? Program->FindNodeSlot(node.Index, valueId) : ScriptProgram::InvalidSlot;
+	if (slot == ScriptProgram::InvalidSlot)
+		return LooseValues[(uint64_t(node.ID) << 32) | valueId];
+
+	return Slots[slot];
+}
+
+std::string& ScriptInstance::GetValueStorage(const ValueData& dest)
+{
+	if (&dest >= Slots.data() && &dest < Slots.data() + Slots.size())
+		return SlotStrings[&dest - Slots.data()];
+
+	return LooseStrings[&dest];
+}
+
+void ScriptInstance::SetValueString(ValueData& dest, const std::string& text)
+{
+	std::string& storage = GetValueStorage(dest);
+	if (&text != &storage)
+		storage = text;
+
+	dest.SetString(&storage);
+}
+
+void ScriptInstance::SetValueString(ValueData& dest, const ValueData& value)
+{
+	// numbers and bools are formatted straight into the storage
+	std::string& storage = GetValueStorage(dest);
+	const std::string& text = value.String(storage);
+	if (&text != &storage)
+		storage = text;
+
+	dest.SetString(&storage);
+}
+
+void ScriptInstance::SetStringGlobal(uint32_t index, const ValueData& value, bool literal)
+{
+	if (literal && value.Type == ValueTypes::String)
+	{
+		StringGlobalSlots[index] = value.StringValue;
+		return;
+	}
+
+	std::string& storage = GlobalStrings[index];
+	const std::string& text = value.String(storage);
+	if (&text != &storage)
+		storage = text;
+
+	StringGlobalSlots[index] = &storage;
+}
+
+void ScriptInstance::Suspend(float seconds)
+{
+	Waiting = true;
+	WaitSeconds = seconds > 0 ? seconds : 0;
+}
+
+void ScriptInstance::Resume()
+{
+	Waiting = false;
+	WaitSeconds = 0;
+}
+
+void ScriptInstance::InvalidateValues()
+{
+	NextStep();
+	GlobalEpoch++;
+}
+
+void ScriptInstance::NextStep()
+{
+	if (++StepEpoch == 0)
+	{
+		// the epoch wrapped, make sure no old entry can match it again
+		std::fill(ValueCache.begin(), ValueCache.end(), ValueCacheEntry());
+		StepEpoch = 1;
+	}
 }
 
 void ScriptInstance::PushReturnNode()
 {
-	if (CurrentNode <= Graph.Nodes.size())
-		ReturnStack.push(CurrentNode);
+	if (ProgramCounter != ScriptProgram::InvalidTarget)
+		ReturnStack.push_back(ProgramCounter);
+}
+
+int32_t& ScriptInstance::GetLoopIndex(const Node& node)
+{
+	uint32_t frame = Program ? Program->FindLoopFrame(node.Index) : ScriptProgram::InvalidSlot;
+	if (frame < LoopFrames.size())
+		return LoopFrames[frame];
+
+	// loops the program has no frame for, such as ones added since it was compiled
+	return NodeStateNums.try_emplace(node.ID, -1).first->second;
+}
+
+
+bool ScriptInstance::GetBool(const std::string& name) const
+{
+	uint32_t index = Program ? GlobalSymbols::Find(Program->Globals.Bools, name) : uint32_t(-1);
+	if (index != uint32_t(-1))
+		return BoolGlobalSlots[index] != 0;
+
+	auto itr = BoolGlobals.find(name);
+	return itr != BoolGlobals.end() && itr->second;
+}
+
+float ScriptInstance::GetNumber(const std::string& name) const
+{
+	uint32_t index = Program ? GlobalSymbols::Find(Program->Globals.Numbers, name) : uint32_t(-1);
+	if (index != uint32_t(-1))
+		return NumGlobalSlots[index];
+
+	auto itr = NumGlobals.find(name);
+	return itr != NumGlobals.end() ? itr->second : 0.0f;
+}
+
+const std::string& ScriptInstance::GetString(const std::string& name) const
+{
+	uint32_t index = Program ? GlobalSymbols::Find(Program->Globals.Strings, name) : uint32_t(-1);
+	if (index != uint32_t(-1))
+		return *StringGlobalSlots[index];
+
+	auto itr = StringGlobals.find(name);
+	return itr != StringGlobals.end() ? itr->second : *StringPool::Empty();
 }
 
+void ScriptInstance::SetBool(const std::string& name, bool value)
+{
+	uint32_t index = Program ? GlobalSymbols::Find(Program->Globals.Bools, name) : uint32_t(-1);
+	if (index != uint32_t(-1))
+		BoolGlobalSlots[index] = value;
+	else
+		BoolGlobals[name] = value;
+
+	GlobalEpoch++;
+}
+
+void ScriptInstance::SetNumber(const std::string& name, float value)
+{
+	uint32_t index = Program ? GlobalSymbols::Find(Program->Globals.Numbers, name) : uint32_t(-1);
+	if (index != uint32_t(-1))
+		NumGlobalSlots[index] = value;
+	else
+		NumGlobals[name] = value;
+
+	GlobalEpoch++;
+}
+
+void ScriptInstance::SetString(const std::string& name, const std::string& value)
+{
+	uint32_t index = Program ? GlobalSymbols::Find(Program->Globals.Strings, name) : uint32_t(-1);
+	if (index != uint32_t(-1))
+	{
+		GlobalStrings[index] = value;
+		StringGlobalSlots[index] = &GlobalStrings[index];
+	}
+	else
+	{
+		StringGlobals[name] = value;
+	}
+
+	GlobalEpoch++;
+}
 
 void ScriptInstance::Clear()
 {
-	BoolGlobals.clear();
-	NumGlobals.clear();
-	StringGlobals.clear();
+	if (ResetGlobals)
+	{
+		BoolGlobals.clear();
+		NumGlobals.clear();
+		StringGlobals.clear();
+		BoolGlobalSlots.assign(Program->Globals.Bools.size(), 0);
+		NumGlobalSlots.assign(Program->Globals.Numbers.size(), 0.0f);
+		StringGlobalSlots.assign(Program->Globals.Strings.size(), StringPool::Empty());
+		GlobalStrings.resize(Program->Globals.Strings.size());
+	}
+	else
+	{
+		BoolGlobalSlots.resize(Program->Globals.Bools.size(), 0);
+		NumGlobalSlots.resize(Program->Globals.Numbers.size(), 0.0f);
+		StringGlobalSlots.resize(Program->Globals.Strings.size(), StringPool::Empty());
+		GlobalStrings.resize(Program->Globals.Strings.size());
+
+		// values set by name before the program bound them live in the maps
+		BindGlobals(BoolGlobals, Program->Globals.Bools, BoolGlobalSlots);
+		BindGlobals(NumGlobals, Program->Globals.Numbers, NumGlobalSlots);
+		for (const auto& [name, index] : Program->Globals.Strings)
+		{
+			auto itr = StringGlobals.find(name);
+			if (itr == StringGlobals.end())
+				continue;
+
+			GlobalStrings[index] = std::move(itr->second);
+			StringGlobalSlots[index] = &GlobalStrings[index];
+			StringGlobals.erase(itr);
+		}
+	}
+
 	NodeStateNums.clear();
+	LoopFrames.assign(Program ? Program->LoopFrameCount : 0, -1);
+	GlobalEpoch++;
+
+	Waiting = false;
+	WaitSeconds = 0;
+
+	ReturnStack.clear();
 }
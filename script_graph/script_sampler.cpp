@@ -0,0 +1,168 @@
+#include "script_sampler.h"
+
+#include <algorithm>
+
+ScriptSampler::~ScriptSampler()
+{
+	Stop();
+}
+
+void ScriptSampler::Start(std::chrono::microseconds interval)
+{
+	if (Running.exchange(true))
+		return;
+
+	Thread = std::thread(&ScriptSampler::ThreadMain, this, interval);
+}
+
+void ScriptSampler::Stop()
+{
+	Running = false;
+	if (Thread.joinable())
+		Thread.join();
+}
+
+void ScriptSampler::Reset()
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	Entries.clear();
+}
+
+void ScriptSampler::ThreadMain(std::chrono::microseconds interval)
+{
+	auto next = std::chrono::steady_clock::now();
+	while (Running)
+	{
+		// on a fixed schedule so a slow wake up does not shift every later sample
+		next += interval;
+		std::this_thread::sleep_until(next);
+		Tick.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void ScriptSampler::Record(ScriptInstance& instance, uint32_t pc)
+{
+	const ScriptProgram& program = *instance.GetProgram();
+
+	std::vector<uint32_t> path;
+	path.reserve(instance.ReturnStack.size() + 1);
+	for (uint32_t loopPc : instance.ReturnStack)
+		path.push_back(program.Code[loopPc].NodeId);
+	path.push_back(program.Code[pc].NodeId);
+
+	std::lock_guard<std::mutex> guard(Lock);
+
+	EntrySamples& entry = Entries[{ &instance.GetGraph(), instance.EntryPoint }];
+	entry.Graph = &instance.GetGraph();
+	entry.EntryPoint = instance.EntryPoint;
+	entry.Samples++;
+	entry.Nodes[path.back()]++;
+	entry.Paths[path]++;
+}
+
+void ScriptSampler::SwitchThreadTick()
+{
+	if (LastTick.Sampler != 0)
+		OtherTicks[LastTick.Sampler] = LastTick.Tick;
+
+	auto itr = OtherTicks.find(Id);
+	LastTick.Sampler = Id;
+	LastTick.Tick = itr != OtherTicks.end() ? itr->second : 0;
+}
+
+std::vector<ScriptSampler::EntrySamples> ScriptSampler::GetSamples() const
+{
+	std::lock_guard<std::mutex> guard(Lock);
+
+	std::vector<EntrySamples> samples;
+	for (const auto& [key, entry] : Entries)
+		samples.push_back(entry);
+
+	return samples;
+}
+
+std::string ScriptSampler::GetLabel(const ScriptGraph& graph, uint32_t nodeId)
+{
+	const Node* node = graph.FindNode(nodeId);
+	std::string label = node ? std::string(node->TypeName()) + " " + std::to_string(nodeId) : "node " + std::to_string(nodeId);
+	std::replace(label.begin(), label.end(), ';', '_');
+	return label;
+}
+
+std::string ScriptSampler::GetEntryName(const ScriptGraph& graph, ScriptGraph::EntryHandle entryPoint)
+{
+	const auto& program = graph.GetProgram();
+	if (program)
+	{
+		for (const auto& [name, handle] : program->EntryPoints)
+		{
+			if (handle == entryPoint)
+				return name;
+		}
+	}
+
+	return "entry " + std::to_string(entryPoint);
+}
+
+std::string ScriptSampler::GetReport(size_t maxLines) const
+{
+	std::vector<EntrySamples> samples = GetSamples();
+	if (samples.empty())
+		return "no samples\n";
+
+	auto percent = [](uint64_t count, uint64_t total)
+	{
+		char text[32];
+		snprintf(text, sizeof(text), "%.1f%%", total ? 100.0 * count / total : 0.0);
+		return std::string(text);
+	};
+
+	std::string report;
+	for (const EntrySamples& entry : samples)
+	{
+		report += GetEntryName(*entry.Graph, entry.EntryPoint) + ": " + std::to_string(entry.Samples) + " samples\n";
+
+		std::vector<std::pair<uint32_t, uint64_t>> nodes(entry.Nodes.begin(), entry.Nodes.end());
+		std::stable_sort(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+		for (size_t i = 0; i < nodes.size() && i < maxLines; i++)
+			report += "  " + percent(nodes[i].second, entry.Samples) + " " + GetLabel(*entry.Graph, nodes[i].first) + "\n";
+
+		std::vector<std::pair<const std::vector<uint32_t>*, uint64_t>> paths;
+		for (const auto& [path, count] : entry.Paths)
+			paths.emplace_back(&path, count);
+		std::stable_sort(paths.begin(), paths.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+		report += "  paths\n";
+		for (size_t i = 0; i < paths.size() && i < maxLines; i++)
+		{
+			report += "  " + percent(paths[i].second, entry.Samples) + " ";
+			for (size_t n = 0; n < paths[i].first->size(); n++)
+				report += (n > 0 ? " > " : "") + GetLabel(*entry.Graph, (*paths[i].first)[n]);
+			report += "\n";
+		}
+	}
+
+	return report;
+}
+
+std::string ScriptSampler::GetFlamegraph() const
+{
+	std::vector<EntrySamples> samples = GetSamples();
+
+	std::string folded;
+	for (const EntrySamples& entry : samples)
+	{
+		std::string root = GetEntryName(*entry.Graph, entry.EntryPoint);
+		std::replace(root.begin(), root.end(), ';', '_');
+
+		for (const auto& [path, count] : entry.Paths)
+		{
+			folded += root;
+			for (uint32_t nodeId : path)
+				folded += ";" + GetLabel(*entry.Graph, nodeId);
+			folded += " " + std::to_string(count) + "\n";
+		}
+	}
+
+	return folded;
+}
@@ -0,0 +1,249 @@
+#include "script_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+ScriptScheduler::ScriptScheduler(uint32_t workerCount)
+{
+	WorkerCount = workerCount > 0 ? workerCount : std::max(1u, std::thread::hardware_concurrency());
+
+	for (uint32_t i = 0; i < WorkerCount; i++)
+		Queues.emplace_back(std::make_unique<WorkerQueue>());
+
+	// worker 0 is whoever calls RunFrame
+	for (uint32_t i = 1; i < WorkerCount; i++)
+		Threads.emplace_back(&ScriptScheduler::WorkerMain, this, i);
+}
+
+ScriptScheduler::~ScriptScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(FrameLock);
+		Quit = true;
+	}
+	FrameStart.notify_all();
+
+	for (std::thread& thread : Threads)
+		thread.join();
+}
+
+const ScriptScheduler::FrameStats& ScriptScheduler::RunFrame(std::vector<Job>& jobs, uint32_t maxNodesPerJob)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	FrameCompleted = 0;
+	FrameIncomplete = 0;
+	FrameWaiting = 0;
+	FrameErrors = 0;
+	FrameSteals = 0;
+	FrameNodes = 0;
+
+	uint32_t jobCount = uint32_t(jobs.size());
+	RemainingJobs = jobCount;
+
+	// hand every worker an even share up front, stealing evens out whatever is left
+	uint32_t share = (jobCount + WorkerCount - 1) / WorkerCount;
+	for (uint32_t i = 0; i < WorkerCount; i++)
+	{
+		JobRange range;
+		range.Begin = std::min(jobCount, i * share);
+		range.End = std::min(jobCount, range.Begin + share);
+		if (range.Begin < range.End)
+			Queues[i]->Ranges.push_back(range);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(FrameLock);
+		FrameJobs = jobs.data();
+		FrameBudget = maxNodesPerJob;
+		BusyWorkers = uint32_t(Threads.size());
+		FrameId++;
+	}
+	FrameStart.notify_all();
+
+	WorkFrame(0);
+
+	{
+		std::unique_lock<std::mutex> lock(FrameLock);
+		FrameDone.wait(lock, [this]() { return BusyWorkers == 0; });
+		FrameJobs = nullptr;
+	}
+
+	LastFrame.Jobs = jobCount;
+	LastFrame.Completed = FrameCompleted;
+	LastFrame.Incomplete = FrameIncomplete;
+	LastFrame.Waiting = FrameWaiting;
+	LastFrame.Errors = FrameErrors;
+	LastFrame.Steals = FrameSteals;
+	LastFrame.NodesRun = FrameNodes;
+	LastFrame.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return LastFrame;
+}
+
+void ScriptScheduler::WorkerMain(uint32_t worker)
+{
+	uint64_t lastFrame = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(FrameLock);
+			FrameStart.wait(lock, [&]() { return Quit || FrameId != lastFrame; });
+			if (Quit)
+				return;
+
+			lastFrame = FrameId;
+		}
+
+		WorkFrame(worker);
+
+		{
+			std::lock_guard<std::mutex> lock(FrameLock);
+			BusyWorkers--;
+			if (BusyWorkers == 0)
+				FrameDone.notify_all();
+		}
+	}
+}
+
+void ScriptScheduler::WorkFrame(uint32_t worker)
+{
+	uint32_t completed = 0;
+	uint32_t incomplete = 0;
+	uint32_t waiting = 0;
+	uint32_t errors = 0;
+	uint32_t steals = 0;
+	uint64_t nodes = 0;
+
+	while (RemainingJobs > 0)
+	{
+		// ranges only shrink while their queue is locked, so once every queue is empty the jobs left are all
+		// being run by other workers and there is nothing for this one to do
+		JobRange range;
+		if (!PopRange(worker, range))
+		{
+			if (!StealRange(worker, range))
+				break;
+
+			steals++;
+		}
+
+		for (uint32_t i = range.Begin; i < range.End; i++)
+		{
+			Job& job = FrameJobs[i];
+			RunJob(job);
+
+			nodes += job.NodesRun;
+			switch (job.Status)
+			{
+				case ScriptInstance::Result::Complete:
+					completed++;
+					break;
+				case ScriptInstance::Result::Incomplete:
+					incomplete++;
+					break;
+				case ScriptInstance::Result::Waiting:
+					waiting++;
+					break;
+				case ScriptInstance::Result::Error:
+					errors++;
+					break;
+			}
+		}
+
+		RemainingJobs -= range.End - range.Begin;
+	}
+
+	FrameCompleted += completed;
+	FrameIncomplete += incomplete;
+	FrameWaiting += waiting;
+	FrameErrors += errors;
+	FrameSteals += steals;
+	FrameNodes += nodes;
+}
+
+bool ScriptScheduler::PopRange(uint32_t worker, JobRange& range)
+{
+	WorkerQueue& queue = *Queues[worker];
+	std::lock_guard<std::mutex> lock(queue.Lock);
+	if (queue.Ranges.empty())
+		return false;
+
+	// one grain off the end, the rest stays where other workers can steal it
+	uint32_t grain = std::max(1u, Grain);
+	JobRange& back = queue.Ranges.back();
+	range = back;
+	if (back.End - back.Begin > grain)
+	{
+		range.Begin = back.End - grain;
+		back.End = range.Begin;
+	}
+	else
+	{
+		queue.Ranges.pop_back();
+	}
+
+	return true;
+}
+
+bool ScriptScheduler::StealRange(uint32_t worker, JobRange& range)
+{
+	for (uint32_t i = 1; i < WorkerCount; i++)
+	{
+		WorkerQueue& victim = *Queues[(worker + i) % WorkerCount];
+		std::lock_guard<std::mutex> lock(victim.Lock);
+		if (victim.Ranges.empty())
+			continue;
+
+		// one grain from the cold end, the owner keeps working from the other
+		uint32_t grain = std::max(1u, Grain);
+		JobRange& front = victim.Ranges.front();
+		range = front;
+		if (front.End - front.Begin > grain)
+		{
+			range.End = front.Begin + grain;
+			front.Begin = range.End;
+		}
+		else
+		{
+			victim.Ranges.pop_front();
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+void ScriptScheduler::RunJob(Job& job)
+{
+	job.NodesRun = 0;
+	job.Status = ScriptInstance::Result::Error;
+	if (!job.Instance)
+		return;
+
+	uint32_t budget = FrameBudget > 0 ? FrameBudget : uint32_t(-1);
+
+	if (!job.Instance->Running)
+	{
+		if (job.EntryPoint == ScriptGraph::InvalidEntry)
+		{
+			job.Status = ScriptInstance::Result::Complete;
+			return;
+		}
+
+		job.Status = job.Instance->Start(job.EntryPoint);
+		if (job.Status != ScriptInstance::Result::Incomplete)
+		{
+			job.NodesRun = job.Status != ScriptInstance::Result::Error ? 1 : 0;
+			return;
+		}
+
+		// start runs the entry node
+		job.NodesRun = 1;
+		budget--;
+	}
+
+	ScriptInstance::StepResult result = job.Instance->Step(budget);
+	job.NodesRun += result.NodesRun;
+	job.Status = result.Status;
+}
@@ -0,0 +1,232 @@
+#include "script_snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace
+{
+	template<class T>
+	void Append(uint8_t*& out, const std::vector<T>& values)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "snapshot data must be plain");
+		if (values.empty())
+			return;
+
+		memcpy(out, values.data(), values.size() * sizeof(T));
+		out += values.size() * sizeof(T);
+	}
+
+	template<class T>
+	void Extract(const uint8_t*& in, std::vector<T>& values, uint32_t count)
+	{
+		values.resize(count);
+		if (count == 0)
+			return;
+
+		memcpy(values.data(), in, count * sizeof(T));
+		in += count * sizeof(T);
+	}
+}
+
+ScriptSnapshot ScriptInstance::Snapshot() const
+{
+	ScriptSnapshot snapshot;
+	snapshot.Program = Program;
+
+	ScriptSnapshot::Header header;
+	header.Bools = uint32_t(BoolGlobalSlots.size());
+	header.Numbers = uint32_t(NumGlobalSlots.size());
+	header.Strings = uint32_t(StringGlobalSlots.size());
+	header.Slots = uint32_t(Slots.size());
+	header.LoopFrames = uint32_t(LoopFrames.size());
+	header.ReturnStack = uint32_t(ReturnStack.size());
+	header.CurrentNode = CurrentNode;
+	header.ProgramCounter = ProgramCounter;
+	header.EntryPoint = EntryPoint;
+	header.WaitSeconds = WaitSeconds;
+	header.Running = Running;
+	header.Waiting = Waiting;
+
+	size_t size = sizeof(header)
+		+ BoolGlobalSlots.size() * sizeof(uint8_t)
+		+ NumGlobalSlots.size() * sizeof(float)
+		+ StringGlobalSlots.size() * sizeof(const std::string*)
+		+ Slots.size() * sizeof(ValueData)
+		+ LoopFrames.size() * sizeof(int32_t)
+		+ ReturnStack.size() * sizeof(uint32_t);
+
+	auto data = std::make_shared<std::vector<uint8_t>>(size);
+	uint8_t* out = data->data();
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+
+	Append(out, BoolGlobalSlots);
+	Append(out, NumGlobalSlots);
+	Append(out, StringGlobalSlots);
+	Append(out, Slots);
+	Append(out, LoopFrames);
+	Append(out, ReturnStack);
+	snapshot.Data = std::move(data);
+
+	snapshot.Strings = CaptureStrings();
+
+	if (!BoolGlobals.empty() || !NumGlobals.empty() || !StringGlobals.empty() || !NodeStateNums.empty())
+	{
+		auto dynamic = std::make_shared<ScriptSnapshot::DynamicState>();
+		dynamic->BoolGlobals = BoolGlobals;
+		dynamic->NumGlobals = NumGlobals;
+		dynamic->StringGlobals = StringGlobals;
+		dynamic->NodeStateNums = NodeStateNums;
+		snapshot.Dynamic = std::move(dynamic);
+	}
+
+	return snapshot;
+}
+
+bool ScriptInstance::Restore(const ScriptSnapshot& snapshot)
+{
+	// a snapshot of an instance that never ran has no program and puts this one back to the same fresh state
+	if (!snapshot.IsValid() || (snapshot.Program && snapshot.Program != Graph.GetProgram()))
+		return false;
+
+	// the layout of the slots belongs to the program, an instance that has not run it yet sets up for it here
+	if (Program != snapshot.Program)
+	{
+		Program = snapshot.Program;
+		if (Program)
+		{
+			ReturnStack.reserve(Program->LoopFrameCount + 1);
+			ValueCache.assign(Program->CacheSize, ValueCacheEntry());
+		}
+	}
+
+	const uint8_t* in = snapshot.Data->data();
+	ScriptSnapshot::Header header;
+	memcpy(&header, in, sizeof(header));
+	in += sizeof(header);
+
+	Extract(in, BoolGlobalSlots, header.Bools);
+	Extract(in, NumGlobalSlots, header.Numbers);
+	Extract(in, StringGlobalSlots, header.Strings);
+	Extract(in, Slots, header.Slots);
+	Extract(in, LoopFrames, header.LoopFrames);
+	Extract(in, ReturnStack, header.ReturnStack);
+
+	RestoreStrings(snapshot.Strings.get());
+
+	CurrentNode = header.CurrentNode;
+	ProgramCounter = header.ProgramCounter;
+	EntryPoint = header.EntryPoint;
+	WaitSeconds = header.WaitSeconds;
+	Running = header.Running;
+	Waiting = header.Waiting;
+
+	if (snapshot.Dynamic)
+	{
+		BoolGlobals = snapshot.Dynamic->BoolGlobals;
+		NumGlobals = snapshot.Dynamic->NumGlobals;
+		StringGlobals = snapshot.Dynamic->StringGlobals;
+		NodeStateNums = snapshot.Dynamic->NodeStateNums;
+	}
+	else
+	{
+		BoolGlobals.clear();
+		NumGlobals.clear();
+		StringGlobals.clear();
+		NodeStateNums.clear();
+	}
+
+	// cached values may point at state from before the restore
+	InvalidateValues();
+	return true;
+}
+
+std::shared_ptr<const SnapshotStrings> ScriptInstance::CaptureStrings() const
+{
+	std::shared_ptr<SnapshotStrings> strings;
+	auto get = [&strings]()
+	{
+		if (!strings)
+			strings = std::make_shared<SnapshotStrings>();
+		return strings.get();
+	};
+
+	// string globals point at their own text or at an interned string
+	uint32_t globalCount = uint32_t(std::min(StringGlobalSlots.size(), GlobalStrings.size()));
+	for (uint32_t index = 0; index < globalCount; index++)
+	{
+		if (StringGlobalSlots[index] == &GlobalStrings[index])
+			get()->Globals.emplace_back(index, GlobalStrings[index]);
+	}
+
+	// slots point at their own text, a string global's text or an interned string, literals are always interned
+	std::unordered_map<const std::string*, uint32_t> globals;
+	for (uint32_t slot = 0; slot < Slots.size(); slot++)
+	{
+		const ValueData& value = Slots[slot];
+		if (value.Type != ValueTypes::String || (Program && Program->IsConstant(slot)))
+			continue;
+
+		if (slot < SlotStrings.size() && value.StringValue == &SlotStrings[slot])
+		{
+			get()->Slots.emplace_back(slot, SlotStrings[slot]);
+			continue;
+		}
+
+		if (globals.empty())
+		{
+			for (uint32_t index = 0; index < globalCount; index++)
+				globals[&GlobalStrings[index]] = index;
+		}
+
+		auto itr = globals.find(value.StringValue);
+		if (itr != globals.end())
+			get()->SlotGlobals.emplace_back(slot, itr->second);
+	}
+
+	return strings;
+}
+
+void ScriptInstance::RestoreStrings(const SnapshotStrings* strings)
+{
+	SlotStrings.resize(Slots.size());
+	if (GlobalStrings.size() < StringGlobalSlots.size())
+		GlobalStrings.resize(StringGlobalSlots.size());
+
+	if (!strings)
+		return;
+
+	for (const auto& [index, text] : strings->Globals)
+	{
+		GlobalStrings[index] = text;
+		StringGlobalSlots[index] = &GlobalStrings[index];
+	}
+
+	for (const auto& [slot, text] : strings->Slots)
+	{
+		SlotStrings[slot] = text;
+		Slots[slot].StringValue = &SlotStrings[slot];
+	}
+
+	for (const auto& [slot, index] : strings->SlotGlobals)
+		Slots[slot].StringValue = &GlobalStrings[index];
+}
+
+std::unique_ptr<ScriptInstance> ScriptInstance::Fork() const
+{
+	return Fork(Snapshot());
+}
+
+std::unique_ptr<ScriptInstance> ScriptInstance::Fork(const ScriptSnapshot& snapshot) const
+{
+	auto fork = std::make_unique<ScriptInstance>(Graph);
+	fork->UsePrecompiled = UsePrecompiled;
+	fork->UseJit = UseJit;
+	fork->ResetGlobals = ResetGlobals;
+
+	if (!fork->Restore(snapshot))
+		return nullptr;
+
+	return fork;
+}
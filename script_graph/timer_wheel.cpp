@@ -0,0 +1,173 @@
+#include "timer_wheel.h"
+
+#include <cmath>
+
+TimerWheel::TimerWheel(double tickSeconds)
+	: TickSeconds(tickSeconds > 0 ? tickSeconds : 0.001)
+{
+	for (uint32_t level = 0; level < Levels; level++)
+	{
+		for (uint32_t slot = 0; slot < SlotsPerLevel; slot++)
+			Slots[level][slot] = InvalidEntry;
+	}
+}
+
+TimerWheel::TimerId TimerWheel::Park(ScriptInstance& instance)
+{
+	if (!instance.IsWaiting())
+		return InvalidTimer;
+
+	return Schedule(instance, instance.GetWaitSeconds());
+}
+
+TimerWheel::TimerId TimerWheel::Schedule(ScriptInstance& instance, double seconds)
+{
+	uint32_t index = InvalidEntry;
+	if (!FreeEntries.empty())
+	{
+		index = FreeEntries.back();
+		FreeEntries.pop_back();
+	}
+	else
+	{
+		index = uint32_t(Entries.size());
+		Entries.emplace_back();
+	}
+
+	// always at least one tick out, the current slot has already been expired
+	double ticks = std::ceil(seconds / TickSeconds);
+	uint64_t maxTicks = (uint64_t(1) << (LevelBits * Levels)) - 1;
+	uint64_t delta = ticks < 1 ? 1 : (ticks >= double(maxTicks) ? maxTicks : uint64_t(ticks));
+
+	Entry& entry = Entries[index];
+	entry.Instance = &instance;
+	entry.Expiry = CurrentTick + delta;
+	entry.Active = true;
+
+	Insert(index);
+	Parked++;
+
+	return (uint64_t(entry.Generation) << 32) | index;
+}
+
+bool TimerWheel::Cancel(TimerId id)
+{
+	uint32_t index = uint32_t(id);
+	uint32_t generation = uint32_t(id >> 32);
+	if (index >= Entries.size())
+		return false;
+
+	Entry& entry = Entries[index];
+	if (!entry.Active || entry.Generation != generation)
+		return false;
+
+	Unlink(index);
+	entry.Active = false;
+	entry.Instance = nullptr;
+	entry.Generation++;
+	FreeEntries.push_back(index);
+	Parked--;
+	return true;
+}
+
+const std::vector<ScriptInstance*>& TimerWheel::Advance(double seconds)
+{
+	Woken.clear();
+
+	PendingTicks += seconds / TickSeconds;
+	while (PendingTicks >= 1)
+	{
+		PendingTicks -= 1;
+		Tick();
+	}
+
+	return Woken;
+}
+
+void TimerWheel::Insert(uint32_t index)
+{
+	Entry& entry = Entries[index];
+
+	// the further out a timer is, the coarser the level it waits in
+	uint64_t delta = entry.Expiry - CurrentTick;
+	uint32_t level = 0;
+	while (level < Levels - 1 && delta >= (uint64_t(1) << (LevelBits * (level + 1))))
+		level++;
+
+	entry.Level = uint8_t(level);
+	entry.Slot = uint8_t((entry.Expiry >> (LevelBits * level)) & SlotMask);
+
+	uint32_t& head = Slots[entry.Level][entry.Slot];
+	entry.Prev = InvalidEntry;
+	entry.Next = head;
+	if (head != InvalidEntry)
+		Entries[head].Prev = index;
+	head = index;
+}
+
+void TimerWheel::Unlink(uint32_t index)
+{
+	Entry& entry = Entries[index];
+
+	if (entry.Prev != InvalidEntry)
+		Entries[entry.Prev].Next = entry.Next;
+	else
+		Slots[entry.Level][entry.Slot] = entry.Next;
+
+	if (entry.Next != InvalidEntry)
+		Entries[entry.Next].Prev = entry.Prev;
+
+	entry.Prev = InvalidEntry;
+	entry.Next = InvalidEntry;
+}
+
+void TimerWheel::Cascade(uint32_t level)
+{
+	uint32_t& head = Slots[level][(CurrentTick >> (LevelBits * level)) & SlotMask];
+
+	// everything in this slot now falls inside the range of a finer level
+	uint32_t index = head;
+	head = InvalidEntry;
+	while (index != InvalidEntry)
+	{
+		uint32_t next = Entries[index].Next;
+		Insert(index);
+		index = next;
+	}
+}
+
+void TimerWheel::Tick()
+{
+	CurrentTick++;
+
+	// each time a level wraps, the next level up spills its current slot down
+	for (uint32_t level = 1; level < Levels; level++)
+	{
+		if (((CurrentTick >> (LevelBits * (level - 1))) & SlotMask) != 0)
+			break;
+
+		Cascade(level);
+	}
+
+	uint32_t& head = Slots[0][CurrentTick & SlotMask];
+	uint32_t index = head;
+	head = InvalidEntry;
+	while (index != InvalidEntry)
+	{
+		Entry& entry = Entries[index];
+		uint32_t next = entry.Next;
+
+		entry.Instance->Resume();
+		Woken.push_back(entry.Instance);
+
+		entry.Active = false;
+		entry.Instance = nullptr;
+		entry.Prev = InvalidEntry;
+		entry.Next = InvalidEntry;
+		entry.Generation++;
+		FreeEntries.push_back(index);
+		Parked--;
+
+		index = next;
+	}
+}
@@ -9,8 +9,17 @@ For a C++ project simply rename the file to .cpp and run premake
 #define _CRT_SECURE_NO_WARNINGS
 
 #include "script_graph.h"
+#include "graph_serializer.h"
+#include "script_program.h"
+#include "script_profiler.h"
+#include "script_batch.h"
+#include "script_sampler.h"
+#include "script_scheduler.h"
+#include "script_snapshot.h"
+#include "timer_wheel.h"
 
 #include <chrono>
+#include <thread>
 
 ScriptGraph Graph;
 
@@ -56,75 +65,652 @@ void SetupGraph()
 	Graph.Nodes[5] = (log);
 }
 
-void SaveScript(const ScriptGraph& graph, const std::string& filename)
+void WriteText(const std::string& text, const std::string& filename)
 {
-	ScriptResource scriptRes;
-	graph.Write(scriptRes);
-
-	FILE* fp = fopen(filename.c_str(), "w+");
+	FILE* fp = fopen(filename.c_str(), "w");
 	if (!fp)
 		return;
 
-	uint32_t count = uint32_t(scriptRes.Nodes.size());
+	fputs(text.c_str(), fp);
+	fclose(fp);
+}
+
+// a pure value that counts how often it is worked out
+class CountedNumber : public Node
+{
+public:
+	DEFINE_NODE(CountedNumber);
 
-	fwrite(&count, 4, 1, fp);
+	CountedNumber()
+	{
+		AllowInput = false;
+		Values.emplace_back(ValueTypes::Number, "Value", 0);
+	}
 
-	for (const auto& res : scriptRes.Nodes)
+	const ValueData* GetValue(uint32_t id, ScriptInstance& state) const override
 	{
-		fwrite(&res.ID, 4, 1, fp);
+		Evaluations++;
+		ValueData& result = state.GetNodeValue(*this, id);
+		result.SetNumber(3);
+		return &result;
+	}
 
-		unsigned char isEntry = res.EntryPoint ? 1 : 0;
-		fwrite(&isEntry, 1, 1, fp);
+	bool IsPure() const override { return true; }
 
-		fwrite(res.TypeName, NodeResource::MaxNodeName, 1, fp);
-		fwrite(res.Name, NodeResource::MaxNodeName, 1, fp);
+	static inline int Evaluations = 0;
+};
+
+// a native flow node that reads both arguments through GetValue
+class SumArguments : public Node
+{
+public:
+	DEFINE_NODE(SumArguments);
 
-		uint32_t size = uint32_t(res.DataSize);
-		fwrite(&size, 4, 1, fp);
-		fwrite(res.Data, res.DataSize, 1, fp);
+	SumArguments()
+	{
+		OutputNodeRefs.emplace_back("Out");
+		Arguments.emplace_back(ValueTypes::Number, "A");
+		Arguments.emplace_back(ValueTypes::Number, "B");
 	}
-	fclose(fp);
+
+	const NodeRef* Process(ScriptInstance& state) const override
+	{
+		auto* a = state.GetValue(Arguments[0]);
+		auto* b = state.GetValue(Arguments[1]);
+		Sum = (a ? a->Number() : 0) + (b ? b->Number() : 0);
+		return &OutputNodeRefs[0];
+	}
+
+	static inline float Sum = 0;
+};
+
+// a native flow node that keeps the thread busy for a while
+class BurnTime : public Node
+{
+public:
+	DEFINE_NODE(BurnTime);
+
+	BurnTime()
+	{
+		OutputNodeRefs.emplace_back("Out");
+	}
+
+	const NodeRef* Process(ScriptInstance&) const override
+	{
+		auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(2);
+		while (std::chrono::steady_clock::now() < end)
+		{
+		}
+
+		return &OutputNodeRefs[0];
+	}
+};
+
+// a diamond of values loaded from a file, the shared value must be worked out once per step
+bool CheckDiamond()
+{
+	NodeRegistry::RegisterNode<CountedNumber>();
+	NodeRegistry::RegisterNode<SumArguments>();
+
+	ScriptGraph diamond;
+
+	EntryNode* entry = new EntryNode();
+	entry->Name = "Diamond";
+	diamond.AddNode(entry);
+	diamond.EntryNodes[entry->Name] = entry;
+
+	CountedNumber* shared = new CountedNumber();
+	diamond.AddNode(shared);
+
+	NumberLiteral* one = new NumberLiteral(1);
+	diamond.AddNode(one);
+
+	Math* add = new Math(Math::Operation::Add);
+	diamond.AddNode(add);
+	add->Arguments[0].ID = shared->ID;
+	add->Arguments[1].ID = one->ID;
+
+	Math* multiply = new Math(Math::Operation::Multiply);
+	diamond.AddNode(multiply);
+	multiply->Arguments[0].ID = shared->ID;
+	multiply->Arguments[1].ID = shared->ID;
+
+	SumArguments* sum = new SumArguments();
+	diamond.AddNode(sum);
+	sum->Arguments[0].ID = add->ID;
+	sum->Arguments[1].ID = multiply->ID;
+	entry->OutputNodeRefs[0].ID = sum->ID;
+
+	GraphSerializer::SaveScript(diamond, "diamond.script");
+	ScriptGraph loaded = GraphSerializer::LoadScript("diamond.script");
+	remove("diamond.script");
+
+	CountedNumber::Evaluations = 0;
+	ScriptInstance instance(loaded);
+	instance.Run("Diamond");
+
+	printf("diamond: sum %g, shared value worked out %d times\n", SumArguments::Sum, CountedNumber::Evaluations);
+	return SumArguments::Sum == 13 && CountedNumber::Evaluations == 1;
 }
 
-ScriptGraph LoadScript(const std::string& filename)
+// a graph built by hand runs without Compile being called, and again after it is edited
+bool CheckUncompiled()
 {
-	ScriptGraph script;
-	FILE* fp = fopen(filename.c_str(), "r");
-	if (!fp)
-		return script;
+	std::string printed;
+	auto log = PrintLog::LogFunction;
+	PrintLog::LogFunction = [&printed](const std::string& text) { printed += text; };
+
+	ScriptGraph graph;
+
+	EntryNode* entry = new EntryNode();
+	entry->Name = "Entry";
+	graph.AddNode(entry);
+	graph.EntryNodes[entry->Name] = entry;
+
+	StringLiteral* hello = new StringLiteral("hello");
+	graph.AddNode(hello);
+
+	PrintLog* print = new PrintLog();
+	graph.AddNode(print);
+	print->Arguments[0].ID = hello->ID;
+	entry->OutputNodeRefs[0].ID = print->ID;
+
+	ScriptInstance instance(graph);
+	bool first = instance.Run("Entry") == ScriptInstance::Result::Complete;
 
-	ScriptResource res;
-	uint32_t count = 0;
-	fread(&count, 4, 1, fp);
+	StringLiteral* world = new StringLiteral(" world");
+	graph.AddNode(world);
 
-	for (uint32_t i = 0; i < count; i++)
+	PrintLog* second = new PrintLog();
+	graph.AddNode(second);
+	second->Arguments[0].ID = world->ID;
+	print->OutputNodeRefs[0].ID = second->ID;
+
+	bool edited = instance.Run("Entry") == ScriptInstance::Result::Complete;
+
+	PrintLog::LogFunction = log;
+
+	printf("uncompiled: printed \"%s\"\n", printed.c_str());
+	return first && edited && printed == "hellohello world";
+}
+
+// runs a graph once a frame with idle time between frames, the samples must land on the node that takes the time
+// and not on the first node of each run
+bool CheckSampler()
+{
+	ScriptGraph graph;
+
+	EntryNode* entry = new EntryNode();
+	entry->Name = "Frame";
+	graph.AddNode(entry);
+	graph.EntryNodes[entry->Name] = entry;
+
+	StringLiteral* name = new StringLiteral("frame");
+	graph.AddNode(name);
+
+	NumberLiteral* one = new NumberLiteral(1);
+	graph.AddNode(one);
+
+	SaveNumber* save = new SaveNumber();
+	graph.AddNode(save);
+	save->Arguments[0].ID = name->ID;
+	save->Arguments[1].ID = one->ID;
+	entry->OutputNodeRefs[0].ID = save->ID;
+
+	BurnTime* burn = new BurnTime();
+	graph.AddNode(burn);
+	save->OutputNodeRefs[0].ID = burn->ID;
+
+	ScriptSampler sampler;
+	ScriptInstance instance(graph);
+	instance.Sampler = &sampler;
+	sampler.Start(std::chrono::microseconds(200));
+
+	for (int frame = 0; frame < 20; frame++)
 	{
-		NodeResource nodeRes;
+		instance.Run("Frame");
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
 
-		fread(&nodeRes.ID, 4, 1, fp);
-		unsigned char b = 0;
-		fread(&b, 1, 1, fp);
-		nodeRes.EntryPoint = b != 0;
+	sampler.Stop();
 
-		fread(nodeRes.TypeName, NodeResource::MaxNodeName, 1, fp);
-		fread(nodeRes.Name, NodeResource::MaxNodeName, 1, fp);
+	uint64_t total = 0;
+	uint64_t burned = 0;
+	for (const auto& entrySamples : sampler.GetSamples())
+	{
+		total += entrySamples.Samples;
+		auto itr = entrySamples.Nodes.find(burn->ID);
+		if (itr != entrySamples.Nodes.end())
+			burned += itr->second;
+	}
 
-		uint32_t size = 0;
-		fread(&size, 4, 1, fp);
-		nodeRes.DataSize = size_t(size);
-		nodeRes.Data = malloc(size);
-		if (nodeRes.Data)
-			fread(nodeRes.Data, nodeRes.DataSize, 1, fp);
-		else
-			break;
+	printf("sampler: %llu of %llu samples on the busy node\n", (unsigned long long)burned, (unsigned long long)total);
+	return total > 0 && burned * 10 >= total * 9;
+}
 
-		res.Nodes.emplace_back(std::move(nodeRes));
+// a loop that adds each instance's own seed into a total, built without calling Compile
+void BuildAccumulate(ScriptGraph& graph, int iterations)
+{
+	EntryNode* entry = new EntryNode();
+	entry->Name = "Accumulate";
+	graph.AddNode(entry);
+	graph.EntryNodes[entry->Name] = entry;
+
+	Loop* loop = new Loop();
+	loop->Itterations = iterations;
+	graph.AddNode(loop);
+	entry->OutputNodeRefs[0].ID = loop->ID;
+
+	StringLiteral* totalName = new StringLiteral("total");
+	graph.AddNode(totalName);
+
+	StringLiteral* seedName = new StringLiteral("seed");
+	graph.AddNode(seedName);
+
+	LoadNumber* total = new LoadNumber();
+	graph.AddNode(total);
+	total->Arguments[0].ID = totalName->ID;
+
+	LoadNumber* seed = new LoadNumber();
+	graph.AddNode(seed);
+	seed->Arguments[0].ID = seedName->ID;
+
+	Math* add = new Math(Math::Operation::Add);
+	graph.AddNode(add);
+	add->Arguments[0].ID = total->ID;
+	add->Arguments[1].ID = seed->ID;
+
+	SaveNumber* save = new SaveNumber();
+	graph.AddNode(save);
+	save->Arguments[0].ID = totalName->ID;
+	save->Arguments[1].ID = add->ID;
+	loop->OutputNodeRefs[1].ID = save->ID;
+}
+
+// many instances on a few workers must all complete with the same globals a serial run gives
+bool CheckScheduler()
+{
+	constexpr uint32_t instanceCount = 500;
+	constexpr int iterations = 25;
+
+	ScriptGraph graph;
+	BuildAccumulate(graph, iterations);
+
+	std::vector<std::unique_ptr<ScriptInstance>> parallel;
+	std::vector<std::unique_ptr<ScriptInstance>> serial;
+	std::vector<ScriptScheduler::Job> jobs;
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		for (auto* instances : { &parallel, &serial })
+		{
+			instances->emplace_back(std::make_unique<ScriptInstance>(graph));
+			instances->back()->ResetGlobals = false;
+			instances->back()->SetNumber("seed", float(i % 17));
+		}
+
+		ScriptScheduler::Job job;
+		job.Instance = parallel.back().get();
+		jobs.push_back(job);
 	}
 
-	fclose(fp);
+	bool ran = true;
+	for (auto& instance : serial)
+		ran = instance->Run("Accumulate") == ScriptInstance::Result::Complete && ran;
+
+	ScriptGraph::EntryHandle handle = graph.GetEntryHandle("Accumulate");
+	for (ScriptScheduler::Job& job : jobs)
+		job.EntryPoint = handle;
+
+	ScriptScheduler scheduler(4);
+	scheduler.Grain = 8;
+	const ScriptScheduler::FrameStats& stats = scheduler.RunFrame(jobs);
+
+	bool match = ran;
+	uint64_t nodes = 0;
+	for (uint32_t i = 0; i < instanceCount; i++)
+	{
+		nodes += jobs[i].NodesRun;
+		match = match && jobs[i].Status == ScriptInstance::Result::Complete;
+		match = match && serial[i]->GetNumber("total") == float(i % 17) * iterations;
+		match = match && parallel[i]->GetNumber("total") == serial[i]->GetNumber("total");
+	}
+
+	bool counted = stats.Jobs == instanceCount && stats.Completed == instanceCount
+		&& stats.Incomplete == 0 && stats.Waiting == 0 && stats.Errors == 0 && stats.NodesRun == nodes && nodes > 0;
+
+	printf("scheduler: %u jobs on %u workers, %u complete, %u steals, %llu nodes\n", stats.Jobs, scheduler.GetWorkerCount(),
+		stats.Completed, stats.Steals, (unsigned long long)stats.NodesRun);
+	return match && counted;
+}
 
-	script.Read(res);
-	return script;
+// a loop that keeps a running total and the total as text, the text is made while running so it belongs to the instance
+void BuildLabels(ScriptGraph& graph)
+{
+	EntryNode* entry = new EntryNode();
+	entry->Name = "Labels";
+	graph.AddNode(entry);
+	graph.EntryNodes[entry->Name] = entry;
+
+	Loop* loop = new Loop();
+	loop->Itterations = 10;
+	graph.AddNode(loop);
+	entry->OutputNodeRefs[0].ID = loop->ID;
+
+	StringLiteral* totalName = new StringLiteral("total");
+	graph.AddNode(totalName);
+
+	StringLiteral* labelName = new StringLiteral("label");
+	graph.AddNode(labelName);
+
+	LoadNumber* total = new LoadNumber();
+	graph.AddNode(total);
+	total->Arguments[0].ID = totalName->ID;
+
+	Math* add = new Math(Math::Operation::Add);
+	graph.AddNode(add);
+	add->Arguments[0].ID = total->ID;
+	add->Arguments[1].ID = loop->ID;
+
+	SaveNumber* saveTotal = new SaveNumber();
+	graph.AddNode(saveTotal);
+	saveTotal->Arguments[0].ID = totalName->ID;
+	saveTotal->Arguments[1].ID = add->ID;
+	loop->OutputNodeRefs[1].ID = saveTotal->ID;
+
+	// a number wired into a string pin, converted to text as the script runs
+	SaveString* saveLabel = new SaveString();
+	graph.AddNode(saveLabel);
+	saveLabel->Arguments[0].ID = labelName->ID;
+	saveLabel->Arguments[1].ID = total->ID;
+	saveTotal->OutputNodeRefs[0].ID = saveLabel->ID;
+
+	LoadString* label = new LoadString();
+	graph.AddNode(label);
+	label->Arguments[0].ID = labelName->ID;
+
+	PrintLog* print = new PrintLog();
+	graph.AddNode(print);
+	print->Arguments[0].ID = label->ID;
+	saveLabel->OutputNodeRefs[0].ID = print->ID;
+}
+
+// snapshots taken part way through a loop, restored and forked, must finish the same as a run that was never stopped
+bool CheckSnapshot()
+{
+	std::string printed;
+	auto log = PrintLog::LogFunction;
+	PrintLog::LogFunction = [&printed](const std::string& text) { printed += text + "\n"; };
+
+	ScriptGraph graph;
+	BuildLabels(graph);
+
+	ScriptInstance reference(graph);
+	bool ok = reference.Run("Labels") == ScriptInstance::Result::Complete;
+	std::string expected = printed;
+
+	// the globals match the reference and what was printed from printedFrom on matches its output from expectedFrom on
+	auto matches = [&](const ScriptInstance& instance, size_t printedFrom, size_t expectedFrom)
+	{
+		return instance.GetNumber("total") == reference.GetNumber("total")
+			&& instance.GetString("label") == reference.GetString("label")
+			&& printed.compare(printedFrom, std::string::npos, expected, expectedFrom, std::string::npos) == 0;
+	};
+
+	auto finish = [](ScriptInstance& instance)
+	{
+		while (instance.Step(3).Status == ScriptInstance::Result::Incomplete)
+		{
+		}
+	};
+
+	for (uint32_t stop = 1; stop < 40 && ok; stop += 3)
+	{
+		printed.clear();
+		auto source = std::make_unique<ScriptInstance>(graph);
+		source->Start("Labels");
+		source->Step(stop);
+
+		ScriptSnapshot snapshot = source->Snapshot();
+		size_t atSnapshot = printed.size();
+
+		// run on, then go back and run the rest again
+		finish(*source);
+		ok = ok && matches(*source, 0, 0);
+
+		size_t beforeRestore = printed.size();
+		ok = ok && source->Restore(snapshot);
+		finish(*source);
+		ok = ok && matches(*source, beforeRestore, atSnapshot);
+
+		// a fork must keep going after the instance it came from is gone
+		std::unique_ptr<ScriptInstance> fork = source->Fork(snapshot);
+		source.reset();
+
+		size_t beforeFork = printed.size();
+		ok = ok && fork != nullptr;
+		if (fork)
+		{
+			finish(*fork);
+			ok = ok && matches(*fork, beforeFork, atSnapshot);
+		}
+	}
+
+	PrintLog::LogFunction = log;
+
+	printf("snapshot: restore and fork %s, total %g, label \"%s\"\n", ok ? "match" : "differ", reference.GetNumber("total"), reference.GetString("label").c_str());
+	return ok;
+}
+
+// a loop whose branch depends on each instance's own "x", so lanes in a batch take different ways through it
+void BuildBranches(ScriptGraph& graph)
+{
+	EntryNode* entry = new EntryNode();
+	entry->Name = "Branches";
+	graph.AddNode(entry);
+	graph.EntryNodes[entry->Name] = entry;
+
+	Loop* loop = new Loop();
+	loop->Itterations = 6;
+	graph.AddNode(loop);
+	entry->OutputNodeRefs[0].ID = loop->ID;
+
+	StringLiteral* xName = new StringLiteral("x");
+	graph.AddNode(xName);
+
+	StringLiteral* totalName = new StringLiteral("total");
+	graph.AddNode(totalName);
+
+	StringLiteral* lowName = new StringLiteral("low");
+	graph.AddNode(lowName);
+
+	StringLiteral* doneName = new StringLiteral("done");
+	graph.AddNode(doneName);
+
+	LoadNumber* x = new LoadNumber();
+	graph.AddNode(x);
+	x->Arguments[0].ID = xName->ID;
+
+	LoadNumber* total = new LoadNumber();
+	graph.AddNode(total);
+	total->Arguments[0].ID = totalName->ID;
+
+	NumberLiteral* three = new NumberLiteral(3);
+	graph.AddNode(three);
+
+	NumberLiteral* one = new NumberLiteral(1);
+	graph.AddNode(one);
+
+	// x + index > 3
+	Math* shifted = new Math(Math::Operation::Add);
+	graph.AddNode(shifted);
+	shifted->Arguments[0].ID = x->ID;
+	shifted->Arguments[1].ID = loop->ID;
+
+	NumberComparison* high = new NumberComparison(NumberComparison::Operation::GreaterThan);
+	graph.AddNode(high);
+	high->Arguments[0].ID = shifted->ID;
+	high->Arguments[1].ID = three->ID;
+
+	Condition* branch = new Condition();
+	graph.AddNode(branch);
+	branch->Arguments[0].ID = high->ID;
+	loop->OutputNodeRefs[1].ID = branch->ID;
+
+	// true, total += x * index
+	Math* scaled = new Math(Math::Operation::Multiply);
+	graph.AddNode(scaled);
+	scaled->Arguments[0].ID = x->ID;
+	scaled->Arguments[1].ID = loop->ID;
+
+	Math* grown = new Math(Math::Operation::Add);
+	graph.AddNode(grown);
+	grown->Arguments[0].ID = total->ID;
+	grown->Arguments[1].ID = scaled->ID;
+
+	SaveNumber* grow = new SaveNumber();
+	graph.AddNode(grow);
+	grow->Arguments[0].ID = totalName->ID;
+	grow->Arguments[1].ID = grown->ID;
+	branch->OutputNodeRefs[0].ID = grow->ID;
+
+	// false, total -= 1 and low is set
+	Math* shrunk = new Math(Math::Operation::Subtract);
+	graph.AddNode(shrunk);
+	shrunk->Arguments[0].ID = total->ID;
+	shrunk->Arguments[1].ID = one->ID;
+
+	SaveNumber* shrink = new SaveNumber();
+	graph.AddNode(shrink);
+	shrink->Arguments[0].ID = totalName->ID;
+	shrink->Arguments[1].ID = shrunk->ID;
+	branch->OutputNodeRefs[1].ID = shrink->ID;
+
+	BooleanLiteral* yes = new BooleanLiteral(true);
+	graph.AddNode(yes);
+
+	SaveBool* markLow = new SaveBool();
+	graph.AddNode(markLow);
+	markLow->Arguments[0].ID = lowName->ID;
+	markLow->Arguments[1].ID = yes->ID;
+	shrink->OutputNodeRefs[0].ID = markLow->ID;
+
+	// after the loop, done = total > 3
+	NumberComparison* big = new NumberComparison(NumberComparison::Operation::GreaterThan);
+	graph.AddNode(big);
+	big->Arguments[0].ID = total->ID;
+	big->Arguments[1].ID = three->ID;
+
+	SaveBool* markDone = new SaveBool();
+	graph.AddNode(markDone);
+	markDone->Arguments[0].ID = doneName->ID;
+	markDone->Arguments[1].ID = big->ID;
+	loop->OutputNodeRefs[0].ID = markDone->ID;
+}
+
+// lanes run in lockstep must end with the same globals and result as each instance run on its own
+bool CheckBatch()
+{
+	constexpr uint32_t laneCount = 24;
+
+	ScriptGraph graph;
+	BuildBranches(graph);
+
+	std::vector<std::unique_ptr<ScriptInstance>> batched;
+	std::vector<std::unique_ptr<ScriptInstance>> scalar;
+	std::vector<ScriptInstance*> lanes;
+	for (uint32_t i = 0; i < laneCount; i++)
+	{
+		for (auto* instances : { &batched, &scalar })
+		{
+			instances->emplace_back(std::make_unique<ScriptInstance>(graph));
+			instances->back()->ResetGlobals = false;
+			instances->back()->SetNumber("x", float(i % 7) - 2);
+		}
+
+		lanes.push_back(batched.back().get());
+	}
+
+	std::vector<ScriptInstance::Result> expected;
+	for (auto& instance : scalar)
+		expected.push_back(instance->Run("Branches"));
+
+	ScriptBatch batch(graph);
+	const ScriptBatch::BatchStats& stats = batch.Run(graph.GetEntryHandle("Branches"), lanes);
+
+	bool match = stats.Lanes == laneCount && stats.Splits > 0;
+	for (uint32_t i = 0; i < laneCount; i++)
+	{
+		match = match && batch.Results[i] == expected[i] && expected[i] == ScriptInstance::Result::Complete;
+		match = match && batched[i]->GetNumber("total") == scalar[i]->GetNumber("total");
+		match = match && batched[i]->GetBool("low") == scalar[i]->GetBool("low");
+		match = match && batched[i]->GetBool("done") == scalar[i]->GetBool("done");
+	}
+
+	printf("batch: %u lanes, %u splits, %u merges, %u finished scalar, %s\n", stats.Lanes, stats.Splits, stats.Merges,
+		stats.ScalarLanes, match ? "match" : "differ");
+	return match;
+}
+
+// timers must wake on the exact tick they were due, including those that waited in a coarser level and cascaded down,
+// and a handle must stop working once its timer is gone, even after its entry was handed to another timer
+bool CheckTimerWheel()
+{
+	ScriptGraph graph;
+	TimerWheel wheel(1.0);
+
+	// either side of each level boundary, some scheduled once the wheel has moved off zero
+	const uint64_t delays[] = { 1, 2, 255, 256, 257, 511, 512, 65535, 65536, 65537, 70000, 300, 256, 65536, 1 };
+	const uint64_t scheduledAt[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 200, 200, 200, 70000 };
+	constexpr size_t timerCount = sizeof(delays) / sizeof(delays[0]);
+
+	std::vector<std::unique_ptr<ScriptInstance>> instances;
+	std::map<const ScriptInstance*, uint64_t> due;
+	std::map<const ScriptInstance*, uint64_t> woke;
+	bool ordered = true;
+	uint64_t lastWake = 0;
+
+	// a timer cancelled before its entry is reused, the stale handle must not cancel the timer that took the entry
+	ScriptInstance cancelled(graph);
+	TimerWheel::TimerId stale = wheel.Schedule(cancelled, 10);
+	bool cancels = wheel.Cancel(stale) && !wheel.Cancel(stale);
+
+	ScriptInstance reused(graph);
+	TimerWheel::TimerId reusedId = wheel.Schedule(reused, 50);
+
+	// the low half of a handle is the entry, so both handles name the same one
+	cancels = cancels && uint32_t(reusedId) == uint32_t(stale) && !wheel.Cancel(stale);
+	due[&reused] = 50;
+
+	size_t next = 0;
+	while (wheel.GetCurrentTick() <= 140000)
+	{
+		for (; next < timerCount && scheduledAt[next] == wheel.GetCurrentTick(); next++)
+		{
+			instances.emplace_back(std::make_unique<ScriptInstance>(graph));
+			wheel.Schedule(*instances.back(), double(delays[next]));
+			due[instances.back().get()] = scheduledAt[next] + delays[next];
+		}
+
+		for (ScriptInstance* instance : wheel.Advance(1.0))
+		{
+			ordered = ordered && wheel.GetCurrentTick() >= lastWake && woke.count(instance) == 0;
+			lastWake = wheel.GetCurrentTick();
+			woke[instance] = wheel.GetCurrentTick();
+		}
+	}
+
+	// the handle of a timer that fired is stale too
+	cancels = cancels && !wheel.Cancel(reusedId);
+
+	bool onTime = woke.size() == due.size() && woke.count(&cancelled) == 0 && wheel.GetParkedCount() == 0;
+	for (const auto& [instance, tick] : due)
+	{
+		auto itr = woke.find(instance);
+		onTime = onTime && itr != woke.end() && itr->second == tick;
+	}
+
+	printf("timer wheel: %zu of %zu timers on time, stale handles %s\n", woke.size(), due.size(), cancels ? "refused" : "accepted");
+	return onTime && ordered && cancels;
 }
 
 int main ()
@@ -135,8 +721,8 @@ int main ()
 
 	Graph.Write(globalRes);
 
-	SaveScript(Graph, "test.script");
-	ScriptGraph otherGraph = LoadScript("test.script");
+	GraphSerializer::SaveScript(Graph, "test.script");
+	ScriptGraph otherGraph = GraphSerializer::LoadScript("test.script");
 
 	ScriptInstance instance(otherGraph);
 
@@ -165,5 +751,68 @@ int main ()
 	double delta = scriptSeconds.count() - nativeSeconds.count();
 	double percent = delta / scriptSeconds.count() * 100;
 	printf("native faster by = %f %%\n", percent);
+
+	if (otherGraph.GetProgram())
+	{
+		printf("fused: %s", otherGraph.GetProgram()->GetFusionReport().c_str());
+		printf("conversions: %s", otherGraph.GetProgram()->GetTypeReport().c_str());
+		printf("verified: %s\n", otherGraph.GetProgram()->Unchecked ? "yes" : "no");
+	}
+
+	for (const std::string& error : otherGraph.VerifyErrors)
+		printf("verify: %s\n", error.c_str());
+
+	// a second run with the profiler attached, for where the script time goes
+	ScriptProfiler profiler;
+	ScriptInstance profiled(otherGraph);
+	profiled.Profiler = &profiler;
+	profiled.Run("Entry");
+
+	printf("\nprofile:\n%s", profiler.GetReport(otherGraph).c_str());
+	WriteText(profiler.GetFlamegraph(otherGraph), "profile.folded");
+	WriteText(profiler.GetChromeTrace(otherGraph), "profile.json");
+
+	if (!CheckDiamond())
+	{
+		printf("diamond check failed\n");
+		return 1;
+	}
+
+	if (!CheckUncompiled())
+	{
+		printf("uncompiled check failed\n");
+		return 1;
+	}
+
+	if (!CheckSampler())
+	{
+		printf("sampler check failed\n");
+		return 1;
+	}
+
+	if (!CheckBatch())
+	{
+		printf("batch check failed\n");
+		return 1;
+	}
+
+	if (!CheckScheduler())
+	{
+		printf("scheduler check failed\n");
+		return 1;
+	}
+
+	if (!CheckSnapshot())
+	{
+		printf("snapshot check failed\n");
+		return 1;
+	}
+
+	if (!CheckTimerWheel())
+	{
+		printf("timer wheel check failed\n");
+		return 1;
+	}
+
 	return 0;
 }
\ No newline at end of file